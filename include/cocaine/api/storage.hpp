@@ -27,6 +27,7 @@
 #include "cocaine/repository.hpp"
 
 #include "cocaine/traits.hpp"
+#include "cocaine/view.hpp"
 
 #include <mutex>
 #include <sstream>
@@ -61,6 +62,17 @@ struct storage_t {
     write(const std::string& collection, const std::string& key, const std::string& blob,
           const std::vector<std::string>& tags) = 0;
 
+    // Writes the blob borrowed right from the incoming frame. Backends which are able to store it
+    // without an owning copy should override this, by default the blob is copied into a string. Not
+    // an overload of write(), so that backends overriding either one wouldn't hide the other.
+    virtual
+    void
+    write_view(const std::string& collection, const std::string& key, const string_view_t& blob,
+               const std::vector<std::string>& tags)
+    {
+        write(collection, key, blob.str(), tags);
+    }
+
     virtual
     void
     remove(const std::string& collection, const std::string& key) = 0;
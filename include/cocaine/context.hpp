@@ -42,6 +42,7 @@ namespace cocaine {
 
 class actor_t;
 class execution_unit_t;
+class placement_t;
 
 class context_t {
     COCAINE_DECLARE_NONCOPYABLE(context_t)
@@ -59,6 +60,9 @@ class context_t {
     // A pool of execution units - threads responsible for doing all the service invocations.
     std::vector<std::unique_ptr<execution_unit_t>> m_pool;
 
+    // Selects execution units for new client connections.
+    std::unique_ptr<placement_t> m_placement;
+
     // Services are stored as a vector of pairs to preserve the initialization order. Synchronized,
     // because services are allowed to start and stop other services during their lifetime.
     synchronized<service_list_t> m_services;
@@ -106,6 +110,9 @@ public:
     auto
     engine() -> execution_unit_t&;
 
+    auto
+    engines() const -> const std::vector<std::unique_ptr<execution_unit_t>>&;
+
 private:
     void
     bootstrap();
@@ -58,6 +58,38 @@ public:
         // I/O thread pool size.
         size_t pool;
 
+        // Policy to select the I/O thread for every new client connection. See placement_t.
+        std::string placement;
+
+        // Whether every I/O thread should accept client connections on its own SO_REUSEPORT socket,
+        // instead of a single service thread accepting them and handing them off to I/O threads.
+        bool reuseport;
+
+        // Whether every service should also accept local clients on a UNIX domain socket under the
+        // runtime path, advertised by the locator alongside its TCP endpoints.
+        bool local;
+
+        struct {
+            // Maximum total size and number of outgoing messages gathered into a single write
+            // operation for client sessions. Zero count disables write batching.
+            size_t bytes;
+            size_t count;
+
+            // Whether to cork TCP sockets while outgoing messages are being gathered.
+            bool cork;
+        } batching;
+
+        struct {
+            // Outgoing data backlog limits in bytes for every client session and for all the client
+            // sessions of an I/O thread. Above the high watermark, reading from the clients is paused
+            // and sending to them fails, until the backlog drains down to the low watermark. Zero high
+            // watermark disables the limit.
+            struct {
+                size_t high;
+                size_t low;
+            } session, engine;
+        } watermarks;
+
         struct {
             // Pinned ports for static service port allocation.
             std::map<std::string, port_t> pinned;
@@ -36,6 +36,7 @@ struct defaults {
     static const unsigned long queue_limit;
     static const unsigned long concurrency;
     static const unsigned long crashlog_limit;
+    static const unsigned long urgent_weight;
 
     // Default I/O policy.
     static const float control_timeout;
@@ -46,6 +47,9 @@ struct defaults {
 
     // Defaults for networking.
     static const std::string endpoint;
+    static const unsigned long batching_bytes;
+    static const unsigned long batching_count;
+    static const std::string placement;
 
     // Defaults for logging service.
     static const std::string log_verbosity;
@@ -23,18 +23,28 @@
 
 #include "cocaine/common.hpp"
 
+#include "cocaine/rpc/session.hpp"
+
 #include <asio/deadline_timer.hpp>
 #include <asio/io_service.hpp>
 #include <asio/ip/tcp.hpp>
+#include <asio/local/stream_protocol.hpp>
 
-namespace cocaine {
+#include <atomic>
 
-class session_t;
+#include <sys/socket.h>
+
+namespace cocaine {
 
-class execution_unit_t {
+class execution_unit_t:
+    private session_t::detach_hook_t
+{
     COCAINE_DECLARE_NONCOPYABLE(execution_unit_t)
 
     class gc_action_t;
+    class probe_action_t;
+
+    context_t& m_context;
 
     std::unique_ptr<logging::log_t> m_log;
 
@@ -42,6 +52,22 @@ class execution_unit_t {
 
     std::map<int, std::shared_ptr<session_t>> m_sessions;
 
+    // Number of sessions attached to this unit and not yet collected. Updated before the sessions
+    // are actually started, so that the placement policy could see connection bursts immediately.
+    std::atomic<size_t> m_active;
+
+    // Number of attached sessions which are still waiting for this unit's reactor to start them.
+    std::atomic<size_t> m_pending;
+
+    // Outgoing messages pool, shared by all the sessions.
+    const std::shared_ptr<io::message_pool_t> m_message_pool;
+
+    // Read buffers pool, shared by all the sessions.
+    const std::shared_ptr<io::buffer_pool_t> m_buffer_pool;
+
+    // Outgoing data backlog watermarks, shared by all the sessions.
+    std::shared_ptr<session_t::backpressure_t> m_backpressure;
+
     // I/O
 
     std::shared_ptr<asio::io_service> m_asio;
@@ -49,21 +75,106 @@ class execution_unit_t {
 
     static const unsigned int kCollectionInterval = 60;
 
-    // Collects detached sessions every kCollectionInterval seconds. Normally, session slots will be
-    // reused because of system fd rotation, but for low loads this will help a bit.
+    // Collects detached sessions every kCollectionInterval seconds. Normally, sessions unregister
+    // themselves once detached, so this is only a safety net.
     asio::deadline_timer m_cron;
 
+    static const unsigned int kProbeInterval = 100;
+
+    // Measures how late the reactor runs a timer handler every kProbeInterval milliseconds. Smoothed
+    // event loop lag in microseconds.
+    asio::deadline_timer m_probe;
+    std::atomic<uint64_t> m_lag;
+
 public:
+    // Live load signals used for the connection placement. Every field is sampled independently.
+    struct load_t {
+        size_t   sessions;
+        size_t   pending;
+        uint64_t lag;
+        size_t   bytes;
+    };
+
     explicit
     execution_unit_t(context_t& context);
 
    ~execution_unit_t();
 
+    // Attaches a connection accepted on another reactor by cloning its socket into this one.
     std::shared_ptr<session_t>
     attach(const std::shared_ptr<asio::ip::tcp::socket>& ptr, const io::dispatch_ptr_t& dispatch);
 
+    // Attaches a connection accepted right on this unit's reactor, e.g., by a sharded acceptor.
+    std::shared_ptr<session_t>
+    attach(std::unique_ptr<asio::ip::tcp::socket> ptr, const io::dispatch_ptr_t& dispatch);
+
+    // Attaches a local connection accepted on another reactor by cloning its socket into this one.
+    std::shared_ptr<session_t>
+    attach(const std::shared_ptr<asio::local::stream_protocol::socket>& ptr,
+           const io::dispatch_ptr_t& dispatch);
+
+    auto
+    get_io_service() -> asio::io_service&;
+
     double
     utilization() const;
+
+    // Thread-safe.
+    auto
+    load() const -> load_t;
+
+private:
+    // Creates a new session for the channel and schedules its start on this unit's reactor.
+    template<class Protocol>
+    std::shared_ptr<session_t>
+    insert(std::unique_ptr<io::channel<Protocol>> channel, const std::string& endpoint,
+           const io::dispatch_ptr_t& dispatch);
+
+    virtual
+    void
+    detached(session_t& session, int key);
+};
+
+// SO_REUSEPORT socket option, which allows multiple sockets to listen on the same endpoint, so that
+// the kernel would balance incoming connections between them. Not available on every platform, and
+// setting it simply fails there.
+
+struct reuse_port_t {
+    explicit
+    reuse_port_t(bool enable):
+        value(enable ? 1 : 0)
+    { }
+
+    template<class Protocol>
+    int
+    level(const Protocol&) const {
+        return SOL_SOCKET;
+    }
+
+    template<class Protocol>
+    int
+    name(const Protocol&) const {
+#if defined(SO_REUSEPORT)
+        return SO_REUSEPORT;
+#else
+        return -1;
+#endif
+    }
+
+    template<class Protocol>
+    const int*
+    data(const Protocol&) const {
+        return &value;
+    }
+
+    template<class Protocol>
+    size_t
+    size(const Protocol&) const {
+        return sizeof(value);
+    }
+
+private:
+    int value;
 };
 
 } // namespace cocaine
@@ -0,0 +1,58 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_PLACEMENT_HPP
+#define COCAINE_PLACEMENT_HPP
+
+#include "cocaine/common.hpp"
+
+namespace cocaine {
+
+class execution_unit_t;
+
+// Connection placement policy, which selects the execution unit to attach a new client session to.
+// Implementations must be thread-safe, because all the services select units concurrently.
+
+class placement_t {
+public:
+    typedef std::vector<std::unique_ptr<execution_unit_t>> pool_type;
+
+    virtual
+   ~placement_t() {
+        // Empty.
+    }
+
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) = 0;
+
+    // Available policies:
+    //   * "load-average", the default, picks the unit with the smallest rolling CPU usage mean;
+    //   * "least-connections" picks the unit with the fewest sessions, then the smallest amount of
+    //     outgoing bytes in flight, then the smallest event loop lag;
+    //   * "power-of-two" compares two random units the same way and picks the lighter one.
+    static
+    std::unique_ptr<placement_t>
+    create(const std::string& name);
+};
+
+} // namespace cocaine
+
+#endif
@@ -47,11 +47,22 @@ class locator_t;
 
 namespace results {
 
-typedef result_of<io::locator::resolve>::type resolve;
+// Same as the protocol's value type, except for the trailing optional local socket path, which is
+// always sent, but as a plain string.
+typedef std::tuple<
+    std::vector<asio::ip::tcp::endpoint>,
+    unsigned int,
+    io::graph_root_t,
+    std::string
+> resolve;
+
 typedef result_of<io::locator::connect>::type connect;
 typedef result_of<io::locator::cluster>::type cluster;
 typedef result_of<io::locator::routing>::type routing;
 
+// Service metadata announced to other nodes, i.e. resolve() results without the local socket path.
+typedef std::tuple_element<1, connect>::type::mapped_type meta;
+
 } // namespace results
 
 class locator_cfg_t
@@ -119,7 +130,7 @@ class locator_t:
     synchronized<remote_map_t> m_remotes;
 
     // Snapshot of the local service disposition. Synchronized with outgoing remote streams.
-    std::map<std::string, results::resolve> m_snapshot;
+    std::map<std::string, results::meta> m_snapshot;
 
     // Outgoing router streams indexed by some arbitrary router-provided uuid.
     synchronized<router_map_t> m_routers;
@@ -173,7 +184,7 @@ private:
     // Context signals
 
     void
-    on_service(const std::string& name, const results::resolve& meta, bool active);
+    on_service(const std::string& name, const results::meta& meta, bool active);
 
     void
     on_context_shutdown();
@@ -43,7 +43,7 @@ public:
 
 private:
     void
-    on_emit(logging::priorities level, std::string&& source, std::string&& message,
+    on_emit(logging::priorities level, const string_view_t& source, const string_view_t& message,
             blackhole::attribute::set_t&& attributes);
 };
 
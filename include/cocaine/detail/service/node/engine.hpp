@@ -29,6 +29,7 @@
 
 #include "cocaine/detail/service/node/event.hpp"
 #include "cocaine/detail/service/node/forwards.hpp"
+#include "cocaine/detail/service/node/index.hpp"
 #include "cocaine/detail/service/node/queue.hpp"
 
 #include "cocaine/rpc/asio/encoder.hpp"
@@ -64,6 +65,10 @@ class engine_t {
     const manifest_t& m_manifest;
     const profile_t& m_profile;
 
+    // Slaves which are able to take more sessions, ordered by their occupancy. Declared before the
+    // event loop, because the slaves captured by its pending handlers remove themselves from it.
+    load_index_t m_index;
+
     // Engine state.
     states m_state;
 
@@ -71,6 +76,12 @@ class engine_t {
     asio::io_service m_loop;
     asio::deadline_timer m_termination_timer;
 
+    // Respawn backoff, so that the apps which crash on start aren't respawned in a tight loop. The
+    // delay doubles with every consecutive slave which has died before becoming active.
+    asio::deadline_timer m_respawn_timer;
+    unsigned int m_failures;
+    bool m_backoff;
+
     // Unix socket server acceptor.
     protocol_type::socket m_socket;
     protocol_type::endpoint m_endpoint;
@@ -79,8 +90,9 @@ class engine_t {
     // Session tagging.
     std::atomic<uint64_t> m_next_id;
 
-    // Session queue.
+    // Session queue and the service time estimate to shed the sessions which can't make it in time.
     session_queue_t m_queue;
+    deadline_estimator_t m_estimator;
 
     // Slave pool.
     typedef std::map<
@@ -153,6 +165,9 @@ private:
     void
     on_termination(const std::error_code& ec);
 
+    void
+    on_respawn(const std::error_code& ec);
+
     void
     erase(const std::string& id, int code, const std::string& reason);
 
@@ -168,6 +183,10 @@ private:
     void
     balance();
 
+    // Whether an idle slave can be retired without cooling the pool down below the minimums.
+    bool
+    retirable();
+
     void
     migrate(states target);
 
@@ -23,6 +23,8 @@
 
 #include "cocaine/common.hpp"
 
+#include <chrono>
+
 namespace cocaine { namespace api {
 
 struct policy_t {
@@ -35,18 +37,28 @@ struct policy_t {
 
     policy_t():
         urgent(false),
+        priority(0),
         timeout(0.0f)
     { }
 
     policy_t(bool urgent_, double timeout_, clock_type::time_point deadline_):
         urgent(urgent_),
+        priority(0),
         timeout(timeout_),
         deadline(deadline_)
     { }
 
+    // Urgent events always go to the highest priority level.
     bool urgent;
+
+    // Priority level, zero being the lowest one. Levels above the configured ones are clamped.
+    unsigned int priority;
+
     double timeout;
     clock_type::time_point deadline;
+
+    // Events are fairly shared between tenants, or between event names if there's no tenant.
+    std::string tenant;
 };
 
 struct event_t {
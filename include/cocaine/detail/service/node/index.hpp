@@ -0,0 +1,83 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_ENGINE_INDEX_HPP
+#define COCAINE_ENGINE_INDEX_HPP
+
+#include "cocaine/common.hpp"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace cocaine { namespace engine {
+
+class slave_t;
+
+// Index of the slaves which are able to take more sessions, ordered by their occupancy. The least
+// occupied slave is picked in O(1), and every occupancy change costs O(log n). Slaves report their
+// own changes, so the pool is never rescanned. Spare slaves, i.e. either starting or idle ones, are
+// counted as well to keep the pool warm. Only touched from the engine thread.
+
+class load_index_t {
+    COCAINE_DECLARE_NONCOPYABLE(load_index_t)
+
+public:
+    explicit
+    load_index_t(size_t concurrency);
+
+    // Re-reads the slave state and occupancy, and either (re-)indexes or drops it.
+    void
+    update(slave_t* slave);
+
+    void
+    remove(slave_t* slave);
+
+    // Returns nullptr if every slave is either busy or inactive.
+    auto
+    pick() const -> slave_t*;
+
+    auto
+    size() const -> size_t {
+        return m_slaves.size();
+    }
+
+    auto
+    spares() const -> size_t {
+        return m_spares.size();
+    }
+
+private:
+    void
+    unindex(slave_t* slave);
+
+    const size_t m_concurrency;
+
+    std::set<std::pair<size_t, slave_t*>> m_index;
+
+    // Current index keys.
+    std::unordered_map<slave_t*, size_t> m_slaves;
+
+    std::unordered_set<slave_t*> m_spares;
+};
+
+}} // namespace cocaine::engine
+
+#endif
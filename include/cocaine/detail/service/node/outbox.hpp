@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef COCAINE_ENGINE_OUTBOX_HPP
+#define COCAINE_ENGINE_OUTBOX_HPP
+
+#include "cocaine/common.hpp"
+
+#include "cocaine/rpc/asio/message_pool.hpp"
+#include "cocaine/rpc/asio/writable_stream.hpp"
+
+#include <asio/local/stream_protocol.hpp>
+
+namespace cocaine { namespace engine {
+
+class ring_transport_t;
+struct session_t;
+
+// Outgoing message queue of a worker connection. Session messages are encoded into pooled buffers
+// and owned by the outbox until written, so the writer notifies about completions via a single
+// stream-wide handler instead of a closure per message.
+
+class outbox_t:
+    public std::enable_shared_from_this<outbox_t>
+{
+    COCAINE_DECLARE_NONCOPYABLE(outbox_t)
+
+    typedef asio::local::stream_protocol protocol_type;
+    typedef io::writable_stream<protocol_type, io::encoder_t> stream_type;
+
+    class write_handler_t;
+
+    asio::io_service& m_asio;
+
+    const std::shared_ptr<stream_type> m_downstream;
+
+    // Shared rings negotiated with the worker, if any. When present, session messages are put into
+    // the outgoing ring instead of being written to the socket.
+    const std::shared_ptr<ring_transport_t> m_rings;
+
+    // Outgoing messages pool.
+    io::message_pool_t m_pool;
+
+    // Messages pushed by the sessions from arbitrary threads, which are yet to be handed over to the
+    // writer on the I/O thread.
+    io::outbound_queue_t m_queue;
+
+    // Intrusive queue of messages which are being written. Only accessed on the I/O thread.
+    io::pooled_message_t* m_head;
+    io::pooled_message_t* m_tail;
+
+    bool m_bound;
+
+    // Messages waiting for free space in the outgoing ring. Only accessed on the I/O thread.
+    io::pooled_message_t* m_waiting_head;
+    io::pooled_message_t* m_waiting_tail;
+
+public:
+    outbox_t(asio::io_service& asio, const std::shared_ptr<stream_type>& downstream,
+             const std::shared_ptr<ring_transport_t>& rings = std::shared_ptr<ring_transport_t>());
+
+   ~outbox_t();
+
+    // Encodes the message on the calling thread and writes it on the I/O thread, which is woken up
+    // at most once per batch of messages. The session is kept alive until the message is written, and
+    // is closed if the write fails.
+    template<class Event, class... Args>
+    void
+    send(const std::shared_ptr<session_t>& session, uint64_t span, Args&&... args);
+
+    // Moves the messages waiting for free space into the outgoing ring. Called when the worker rings
+    // the doorbell. Must be called on the I/O thread.
+    void
+    flush();
+
+    // Rings the worker's doorbell. Must be called on the I/O thread.
+    void
+    notify();
+
+private:
+    void
+    do_drain();
+
+    void
+    do_push(io::pooled_message_t* message);
+
+    void
+    on_write(const std::error_code& ec);
+};
+
+template<class Event, class... Args>
+void
+outbox_t::send(const std::shared_ptr<session_t>& session, uint64_t span, Args&&... args) {
+    auto message = m_pool.acquire();
+
+    io::encoded<Event>::encode(message->message, span, std::forward<Args>(args)...);
+
+    message->owner = session;
+
+    if(m_queue.push(std::move(message))) {
+        // NOTE: Always post, even from the I/O thread, because the writer might be in the middle of
+        // reporting completions.
+        m_asio.post(std::bind(&outbox_t::do_drain, shared_from_this()));
+    }
+}
+
+}} // namespace cocaine::engine
+
+#endif
@@ -52,6 +52,31 @@ struct profile_t:
     unsigned long pool_limit;
     unsigned long queue_limit;
 
+    // Warm pool. The engine keeps at least this many slaves, and at least this many of them spare,
+    // i.e. either starting or idle, spawning replacements in the background. Idle slaves above both
+    // minimums are retired after the idle timeout as usual.
+    unsigned long pool_minimum;
+    unsigned long spare_minimum;
+
+    // Scheduling weights of the priority levels, starting from the lowest one. The number of levels
+    // is the number of weights.
+    std::vector<unsigned long> priority_weights;
+
+    // Fair share weights of tenants or event names. Flows which aren't listed here get weight 1.
+    std::map<std::string, unsigned long> flow_weights;
+
+    // Serve the sessions within every priority level and every slave queue in the order of their
+    // deadlines instead of fairly sharing them between flows.
+    bool deadline_first;
+
+    // Maximum capacity of the shared memory rings between the engine and every slave, in bytes.
+    // Zero disables the shared rings, so that all the messages travel over the unix socket.
+    unsigned long ring_capacity;
+
+    // Minimal size of the chunks which slaves might hand off via memfds instead of sending them over
+    // the unix socket. Zero disables the hand-off.
+    unsigned long handoff_threshold;
+
     // NOTE: The slave processes are launched in sandboxed environments,
     // called isolates. This one describes the isolate type and arguments.
     config_t::component_t isolate;
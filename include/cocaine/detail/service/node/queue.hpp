@@ -21,34 +21,245 @@
 #ifndef COCAINE_ENGINE_QUEUE_HPP
 #define COCAINE_ENGINE_QUEUE_HPP
 
-#include <deque>
+#include "cocaine/common.hpp"
+
+#include "cocaine/detail/service/node/event.hpp"
+#include "cocaine/detail/service/node/forwards.hpp"
+
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace cocaine { namespace engine {
 
 struct session_t;
 
-struct session_queue_t:
-    public std::deque<std::shared_ptr<session_t>>
-{
+namespace aux {
+
+// Bounded multi-producer multi-consumer ring. Every cell carries a sequence number, which tells
+// producers and consumers whether it's their turn to use the cell, so the only contention point is
+// a single CAS on either the head or the tail position. The capacity must be a power of two.
+
+template<class T>
+class bounded_ring_t {
+    COCAINE_DECLARE_NONCOPYABLE(bounded_ring_t)
+
+    static const size_t kCacheLine = 64;
+
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::vector<cell_t> m_cells;
+    const size_t m_mask;
+
+    char pad0[kCacheLine];
+    std::atomic<size_t> m_head;
+    char pad1[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail;
+    char pad2[kCacheLine - sizeof(std::atomic<size_t>)];
+
+public:
+    explicit
+    bounded_ring_t(size_t capacity):
+        m_cells(capacity),
+        m_mask(capacity - 1),
+        m_head(0),
+        m_tail(0)
+    {
+        for(size_t i = 0; i < capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns false if the ring is full, including the case when the oldest cell has been already
+    // claimed by a consumer, but not yet released.
+    bool
+    push(const T& value) {
+        size_t position = m_tail.load(std::memory_order_relaxed);
+
+        while(true) {
+            cell_t& cell = m_cells[position & m_mask];
+
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t delta  = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if(delta == 0) {
+                if(m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(delta < 0) {
+                return false;
+            } else {
+                position = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool
+    pop(T& value) {
+        size_t position = m_head.load(std::memory_order_relaxed);
+
+        while(true) {
+            cell_t& cell = m_cells[position & m_mask];
+
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t delta  = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+            if(delta == 0) {
+                if(m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+
+                    // Don't keep the moved out value alive until the cell is reused.
+                    cell.value = T();
+                    cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(delta < 0) {
+                return false;
+            } else {
+                position = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+} // namespace aux
+
+// Smoothed session service time per event, as observed by the slaves from the session start till its
+// choke. Used to tell in advance whether a session is able to make its deadline. Events are measured
+// separately, so that long streaming sessions wouldn't affect the short ones. Estimates decay while
+// there are no new observations, so that an inflated estimate, which makes every session with a
+// deadline to be shed, wouldn't stick forever.
+
+class deadline_estimator_t {
+    COCAINE_DECLARE_NONCOPYABLE(deadline_estimator_t)
+
+public:
+    typedef api::policy_t::clock_type clock_type;
+
+    deadline_estimator_t() = default;
+
+    // Thread-safe.
     void
-    push(const_reference session);
+    observe(const std::string& event, clock_type::duration elapsed);
+
+    // Whether the session has a deadline which it won't make even if it's started right now.
+    // Thread-safe.
+    bool
+    hopeless(const api::event_t& event, clock_type::time_point now) const;
+
+    auto
+    estimate(const std::string& event, clock_type::time_point now) const -> clock_type::duration;
+
+private:
+    struct sample_t {
+        clock_type::duration estimate;
+        clock_type::time_point updated;
+    };
+
+    static
+    auto
+    decayed(const sample_t& sample, clock_type::time_point now) -> clock_type::duration;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, sample_t> m_samples;
+};
+
+// Bounded session queue with multiple priority levels and weighted fair sharing between flows.
+//
+// Producers are lock-free: every session goes into the ring of its priority level. Consumers stage
+// the ring contents into per-flow queues, where a flow is either the client-supplied tenant tag or,
+// if there's none, the event name, and then serve them with two nested deficit round-robins. Levels
+// get turns proportional to their weights, starting from the highest one, so interactive traffic
+// keeps low latency while lower levels still make progress. Within a level, every flow gets turns
+// proportional to its weight, so that no single event or tenant can hog the slaves. In the deadline
+// first mode, sessions within a level are served in the order of their deadlines instead, and the
+// ones without a deadline go last.
+//
+// The depth is tracked separately from the rings, so that the queue limit is enforced precisely.
+// Cancelled sessions give their places back right away, and are dropped once they're staged or
+// reach the queue head.
+
+class session_queue_t {
+    COCAINE_DECLARE_NONCOPYABLE(session_queue_t)
+
+public:
+    typedef std::shared_ptr<session_t> value_type;
+
+    // The rings are preallocated, so the queue can't be unbounded. This limit is used by the engines
+    // with no queue limit configured, the others get rings sized from their configured limits.
+    static const size_t kDefaultLimit = 8192;
+
+    explicit
+    session_queue_t(const profile_t& profile);
+
+   ~session_queue_t();
 
-    // Lockable concept implementation
+    // Returns false if the queue is full.
+    bool
+    push(const value_type& session);
 
+    // Skips the cancelled sessions.
+    bool
+    pop(value_type& session);
+
+    // Removes the sessions which won't make their deadlines from the heads of the deadline-ordered
+    // levels. Does nothing unless the queue is in the deadline first mode.
     void
-    lock() {
-        m_mutex.lock();
+    shed(const deadline_estimator_t& estimator, std::vector<value_type>& hopeless);
+
+    // Might be slightly stale when observed concurrently with pushes and pops.
+    size_t
+    size() const {
+        return m_size->load(std::memory_order_acquire);
     }
 
-    void
-    unlock() {
-        m_mutex.unlock();
+    bool
+    empty() const {
+        return size() == 0;
+    }
+
+    // The effective queue limit.
+    size_t
+    capacity() const {
+        return m_limit;
     }
 
 private:
+    struct flow_t;
+    struct level_t;
+    struct deadline_t;
+
+    // Moves the sessions from the level rings into the flow queues or the deadline heaps.
+    void
+    stage();
+
+    // Takes the next staged session according to the scheduling policy.
+    bool
+    take(value_type& session);
+
+    auto
+    level_of(const value_type& session) const -> size_t;
+
+    const profile_t& m_profile;
+    const size_t m_limit;
+
+    std::vector<std::unique_ptr<level_t>> m_levels;
+
+    // Consumers' side state, the level which is currently being served and the staging counter to
+    // keep the sessions with equal deadlines in order.
     std::mutex m_mutex;
+    size_t m_cursor;
+    uint64_t m_staged;
+
+    // Shared with the enqueued sessions, so that they could release their places when cancelled.
+    const std::shared_ptr<std::atomic<size_t>> m_size;
 };
 
 }} // namespace cocaine::engine
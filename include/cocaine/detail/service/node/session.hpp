@@ -32,10 +32,14 @@
 #include "cocaine/rpc/asio/writable_stream.hpp"
 #include "cocaine/rpc/queue.hpp"
 
+#include <atomic>
+
 #include <asio/local/stream_protocol.hpp>
 
 namespace cocaine { namespace engine {
 
+class outbox_t;
+
 struct session_t:
     public std::enable_shared_from_this<session_t>
 {
@@ -65,12 +69,18 @@ struct session_t:
         void
         close();
 
+        virtual
+        void
+        cancel();
+
     private:
         std::shared_ptr<session_t> parent;
     };
 
+    // Cancellations are only forwarded to the workers which have announced that they understand
+    // them, the other ones will get the session choked as usual.
     void
-    attach(const std::shared_ptr<io::writable_stream<protocol_type, io::encoder_t>>& downstream);
+    attach(const std::shared_ptr<outbox_t>& outbox, bool cancellable);
 
     void
     detach();
@@ -78,6 +88,25 @@ struct session_t:
     void
     close();
 
+    // Marks the session as cancelled and asks the worker to abort it. Queued sessions give their
+    // place in the queue back right away and are skipped when they reach the queue head, so
+    // cancelling them is O(1).
+    void
+    cancel();
+
+    // The session holds a place in the engine queue depth from the moment it's enqueued till either
+    // it's dequeued or cancelled, whichever comes first.
+    void
+    enqueued(const std::shared_ptr<std::atomic<size_t>>& depth);
+
+    void
+    dequeued();
+
+    bool
+    cancelled() const {
+        return m_cancelled.load(std::memory_order_acquire);
+    }
+
 public:
     // Session ID.
     const uint64_t id;
@@ -88,6 +117,9 @@ public:
     // Client's upstream for response delivery.
     const std::shared_ptr<api::stream_t> upstream;
 
+    // The moment the session has been started on a slave, to measure the service time.
+    api::policy_t::clock_type::time_point started;
+
 private:
     template<class Event, class... Args>
     void
@@ -98,7 +130,6 @@ private:
     send(std::lock_guard<std::mutex>&, Args&&... args);
 
 private:
-    class push_action_t;
     class stream_adapter_t;
     std::shared_ptr<synchronized<io::message_queue<io::rpc_tag, stream_adapter_t>>> m_writer;
 
@@ -111,6 +142,14 @@ private:
 
     // Session state.
     state::value m_state;
+
+    std::atomic<bool> m_cancelled;
+
+    // Whether the worker the session has been attached to understands cancellations.
+    bool m_cancellable;
+
+    // The engine queue depth, while the session holds a place in it.
+    std::shared_ptr<std::atomic<size_t>> m_depth;
 };
 
 template<class Event, class... Args>
@@ -0,0 +1,265 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_ENGINE_SHM_HPP
+#define COCAINE_ENGINE_SHM_HPP
+
+#include "cocaine/common.hpp"
+
+#include <atomic>
+
+namespace cocaine { namespace engine {
+
+// Anonymous shared memory, backed by a memfd, so that it could be handed over to a worker via the
+// unix socket and mapped there.
+
+class shared_memory_t {
+    COCAINE_DECLARE_NONCOPYABLE(shared_memory_t)
+
+    int    m_fd;
+    char*  m_data;
+    size_t m_size;
+
+public:
+    shared_memory_t(const std::string& name, size_t size);
+
+   ~shared_memory_t();
+
+    int
+    fd() const {
+        return m_fd;
+    }
+
+    char*
+    data() const {
+        return m_data;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+};
+
+// Read-only mapping of a memfd received from a worker. Takes over the descriptor.
+
+class shared_mapping_t {
+    COCAINE_DECLARE_NONCOPYABLE(shared_mapping_t)
+
+    int    m_fd;
+    char*  m_data;
+    size_t m_size;
+
+public:
+    // Throws unless the memfd is sealed against shrinking and writes, and is at least of the requested
+    // size, since otherwise the worker could make the mapping fault.
+    shared_mapping_t(int fd, size_t size);
+
+   ~shared_mapping_t();
+
+    const char*
+    data() const {
+        return m_data;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+};
+
+// Single-producer single-consumer ring of frames living in shared memory. Every frame is prefixed
+// with its 32-bit length and might wrap around the end of the ring. An empty frame is a marker,
+// which means that the next data frame travels over the unix socket instead, because it doesn't fit
+// into the ring.
+//
+// Both parties sleep on the unix socket, so the producer rings the doorbell when it publishes frames
+// into a ring which the consumer has drained completely, and the consumer rings it when the producer
+// is waiting for free space.
+
+class shared_ring_t {
+    COCAINE_DECLARE_NONCOPYABLE(shared_ring_t)
+
+    static const size_t kCacheLine = 64;
+
+public:
+    // Shared layout. Positions are the total number of bytes ever published and consumed, so they
+    // never wrap. Every field occupies its own cache line.
+    struct header_t {
+        std::atomic<uint64_t> head;
+        char pad0[kCacheLine - sizeof(std::atomic<uint64_t>)];
+
+        std::atomic<uint64_t> tail;
+        char pad1[kCacheLine - sizeof(std::atomic<uint64_t>)];
+
+        std::atomic<uint32_t> waiting;
+        char pad2[kCacheLine - sizeof(std::atomic<uint32_t>)];
+    };
+
+    static const size_t kFrameHeader = sizeof(uint32_t);
+
+private:
+    header_t *const m_header;
+    char     *const m_data;
+
+    const size_t m_capacity;
+
+    // Storage the frames are copied to before they're handed over, since the producer might still
+    // write to the ring while they're being decoded. Consumer only.
+    std::vector<char> m_scratch;
+
+public:
+    // Capacity must be a power of two. The memory must be footprint(capacity) bytes long, and zeroed
+    // before either party starts using it.
+    shared_ring_t(char* memory, size_t capacity);
+
+    static
+    size_t
+    footprint(size_t capacity) {
+        return sizeof(header_t) + capacity;
+    }
+
+    size_t
+    capacity() const {
+        return m_capacity;
+    }
+
+    bool
+    empty() const;
+
+    // Producer
+
+    // Publishes the frame, if there's enough free space. Sets the doorbell flag, if the consumer has to
+    // be notified, otherwise leaves it intact.
+    bool
+    push(const char* data, size_t size, bool& doorbell);
+
+    // Asks the consumer to ring the doorbell once it frees some space. Returns false if the space has
+    // been freed in the meantime, so there's no need to wait.
+    bool
+    wait(size_t size);
+
+    // Consumer
+
+    // Hands over the published frames to the handler, until the ring is empty or the handler returns
+    // false. Frames are valid only during the call. Returns whether the producer has to be notified.
+    // The producer is not trusted, so the positions and the frame sizes it publishes are validated,
+    // and every frame is copied out of the shared memory first.
+    template<class Handler>
+    bool
+    consume(Handler handler);
+
+private:
+    size_t
+    available() const;
+
+    void
+    read(uint64_t position, char* target, size_t size) const;
+
+    void
+    write(uint64_t position, const char* source, size_t size);
+};
+
+template<class Handler>
+bool
+shared_ring_t::consume(Handler handler) {
+    uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+
+    while(true) {
+        const uint64_t head = m_header->head.load(std::memory_order_acquire);
+
+        if(head == tail) {
+            // NOTE: The producer might have published a frame after observing the old tail, so the
+            // head is checked once again after the tail is published.
+            m_header->tail.store(tail, std::memory_order_seq_cst);
+
+            if(m_header->head.load(std::memory_order_seq_cst) == tail) {
+                break;
+            } else {
+                continue;
+            }
+        }
+
+        if(head - tail > m_capacity || head - tail < kFrameHeader) {
+            throw cocaine::error_t("shared ring position is corrupted");
+        }
+
+        uint32_t size;
+        read(tail, reinterpret_cast<char*>(&size), kFrameHeader);
+
+        if(size > m_capacity - kFrameHeader || size > head - tail - kFrameHeader) {
+            throw cocaine::error_t("shared ring frame is corrupted");
+        }
+
+        m_scratch.resize(size);
+        read(tail + kFrameHeader, m_scratch.data(), size);
+
+        const bool proceed = handler(m_scratch.data(), static_cast<size_t>(size));
+
+        // The frame is no longer needed, so its space can be reused by the producer right away.
+        tail += kFrameHeader + size;
+        m_header->tail.store(tail, std::memory_order_release);
+
+        if(!proceed) {
+            break;
+        }
+    }
+
+    return m_header->waiting.exchange(0, std::memory_order_seq_cst) != 0;
+}
+
+// A pair of rings in a single shared memory region, the first one for the messages from the engine
+// to the worker, the second one for the opposite direction.
+
+class ring_transport_t {
+    COCAINE_DECLARE_NONCOPYABLE(ring_transport_t)
+
+    shared_memory_t m_memory;
+
+    shared_ring_t m_tx;
+    shared_ring_t m_rx;
+
+public:
+    ring_transport_t(const std::string& name, size_t capacity);
+
+    int
+    fd() const {
+        return m_memory.fd();
+    }
+
+    shared_ring_t&
+    tx() {
+        return m_tx;
+    }
+
+    shared_ring_t&
+    rx() {
+        return m_rx;
+    }
+};
+
+// Sends the data over the unix socket along with the descriptor attached via SCM_RIGHTS. Throws if
+// the data couldn't be sent in one go, e.g. when the socket buffer is full.
+void
+send_descriptor(int socket, const char* data, size_t size, int fd);
+
+}} // namespace cocaine::engine
+
+#endif
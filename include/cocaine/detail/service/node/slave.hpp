@@ -26,18 +26,22 @@
 #include "cocaine/api/isolate.hpp"
 
 #include "cocaine/detail/service/node/forwards.hpp"
-#include "cocaine/detail/service/node/queue.hpp"
 
 #include "cocaine/rpc/asio/channel.hpp"
 #include "cocaine/rpc/asio/decoder.hpp"
 
 #include <atomic>
 #include <chrono>
+#include <deque>
 
 #include <asio/local/stream_protocol.hpp>
 
 namespace cocaine { namespace engine {
 
+class deadline_estimator_t;
+class load_index_t;
+class outbox_t;
+class ring_transport_t;
 struct session_t;
 
 class slave_t : public std::enable_shared_from_this<slave_t> {
@@ -63,18 +67,31 @@ class slave_t : public std::enable_shared_from_this<slave_t> {
     const manifest_t& m_manifest;
     const profile_t& m_profile;
 
+    // Shared with the engine, which also sheds the queued sessions using it.
+    deadline_estimator_t& m_estimator;
+
+    // The engine's slave index, which is kept up to date by the slaves themselves.
+    load_index_t& m_index;
+
     // Slave ID.
     const std::string m_id;
 
     // Self engine-control.
     typedef std::function<void()> rebalance_type;
     typedef std::function<void(const std::string&, int, const std::string&)> suicide_type;
+    typedef std::function<bool()> retire_type;
     rebalance_type m_rebalance;
     suicide_type m_suicide;
 
+    // Asked whether an idle slave can go away, which it can't if the pool should be kept warm.
+    retire_type m_retire;
+
     // Health.
     states m_state;
 
+    // Whether the slave has ever become active, to tell the startup failures apart.
+    bool m_activated;
+
 #ifdef COCAINE_HAS_FEATURE_STEADY_CLOCK
     const std::chrono::steady_clock::time_point m_birthstamp;
 #else
@@ -84,10 +101,23 @@ class slave_t : public std::enable_shared_from_this<slave_t> {
     asio::deadline_timer m_heartbeat_timer;
     asio::deadline_timer m_idle_timer;
 
-    // IO communication with worker.
-    io::decoder_t::message_type m_message;
+    // IO communication with worker. The outbox must outlive the channel, because it owns the
+    // messages being written.
+    io::readable_stream<protocol_type, io::decoder_t>::batch_type m_messages;
+    std::shared_ptr<outbox_t> m_outbox;
     std::shared_ptr<io::channel<protocol_type>> m_channel;
 
+    // Shared rings negotiated during the handshake, if any. Messages from the incoming ring are
+    // decoded from their copies, see shared_ring_t::consume(). Consumption stops at a marker frame
+    // until the deferred message arrives over the socket.
+    std::shared_ptr<ring_transport_t> m_rings;
+
+    // Whether the worker understands rpc::cancel.
+    bool m_cancellation;
+    io::decoder_t m_decoder;
+    io::decoder_t::message_type m_frame;
+    bool m_deferred;
+
     // Active sessions (or channels now?).
     typedef std::map<
         uint64_t,
@@ -95,8 +125,12 @@ class slave_t : public std::enable_shared_from_this<slave_t> {
     > session_map_t;
     session_map_t m_sessions;
 
-    // Tagged session queue.
-    session_queue_t m_queue;
+    // Sessions which are assigned, but not yet started or queued.
+    size_t m_assigning;
+
+    // Tagged session queue, ordered by deadlines in the deadline first mode. It's only touched from
+    // the engine thread, so it needs no locking.
+    std::deque<std::shared_ptr<session_t>> m_queue;
 
     // Output capture.
     struct output_t;
@@ -106,17 +140,23 @@ public:
     slave_t(const std::string& id,
             const manifest_t& manifest,
             const profile_t& profile,
+            deadline_estimator_t& estimator,
+            load_index_t& index,
             context_t& context,
             rebalance_type rebalance,
             suicide_type suicide,
+            retire_type retire,
             asio::io_service& asio);
    ~slave_t();
 
-    // Bind IO channel. Single shot.
+    // Bind IO channel and, optionally, the shared rings. Single shot. Cancellation tells whether the
+    // worker has announced the support for the session cancellation.
     void
-    bind(const std::shared_ptr<io::channel<protocol_type>>& channel);
+    bind(const std::shared_ptr<io::channel<protocol_type>>& channel,
+         const std::shared_ptr<ring_transport_t>& rings = std::shared_ptr<ring_transport_t>(),
+         bool cancellation = false);
 
-    // Session scheduling.
+    // Session scheduling. Must be called on the engine thread, as it updates the load index.
     void
     assign(const std::shared_ptr<session_t>& session);
 
@@ -130,12 +170,33 @@ public:
         return m_state == states::active;
     }
 
+    bool
+    activated() const {
+        return m_activated;
+    }
+
     size_t
     load() const {
         return m_sessions.size();
     }
 
+    // Active, queued and being assigned sessions.
+    size_t
+    occupancy() const {
+        return m_sessions.size() + m_queue.size() + m_assigning;
+    }
+
+    // Either starting or idle.
+    bool
+    spare() const {
+        return m_state != states::inactive && occupancy() == 0;
+    }
+
 private:
+    // Reports the state or occupancy change to the engine.
+    void
+    reindex();
+
     void
     do_assign(std::shared_ptr<session_t> session);
 
@@ -165,6 +226,10 @@ private:
     void
     process(const io::decoder_t::message_type& message);
 
+    // Handles a message from the socket in order with the messages from the incoming ring.
+    void
+    receive(const io::decoder_t::message_type& message);
+
     // On any socket error associated with worker.
     void
     on_failure(const std::error_code& ec);
@@ -181,6 +246,10 @@ private:
     void
     on_chunk(uint64_t session_id, const std::string& chunk);
 
+    // Handed off chunk handler.
+    void
+    on_blob(uint64_t session_id, uint64_t size);
+
     // Error handler.
     void
     on_error(uint64_t session_id, int code, const std::string& reason);
@@ -189,6 +258,19 @@ private:
     void
     on_choke(uint64_t session_id);
 
+    // Forwards chunk and error arguments to the upstream as they were packed by the worker. Returns
+    // false if the message has to be unpacked and handled the usual way.
+    bool
+    splice(const io::decoder_t::message_type& message);
+
+    // Doorbell handler.
+    void
+    on_doorbell();
+
+    // Handles the messages from the incoming ring.
+    void
+    drain();
+
     // Called on heartbeat timeout.
     void
     on_timeout(const std::error_code& ec);
@@ -42,6 +42,29 @@ struct stream_t {
     virtual
     void
     close() = 0;
+
+    // Streams which are able to put an already packed argument sequence on the wire verbatim can
+    // override these to spare the caller from unpacking it. Returning false means that the caller
+    // must unpack the arguments and fall back to the methods above.
+
+    virtual
+    bool
+    splice_chunk(const char* /* args */, size_t /* size */) {
+        return false;
+    }
+
+    virtual
+    bool
+    splice_error(const char* /* args */, size_t /* size */) {
+        return false;
+    }
+
+    // Called when nobody is interested in the results anymore, so that the work could be abandoned.
+    virtual
+    void
+    cancel() {
+        // Empty.
+    }
 };
 
 typedef std::shared_ptr<stream_t> stream_ptr_t;
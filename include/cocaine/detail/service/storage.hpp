@@ -37,6 +37,10 @@ struct storage_t:
     virtual
     auto
     prototype() const -> const io::basic_dispatch_t&;
+
+private:
+    // Pool to run the blocking backend operations on, unless disabled.
+    std::shared_ptr<io::executor_t> m_executor;
 };
 
 }} // namespace cocaine::service
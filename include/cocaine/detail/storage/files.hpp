@@ -53,6 +53,11 @@ public:
     write(const std::string& collection, const std::string& key, const std::string& blob,
           const std::vector<std::string>& tags);
 
+    virtual
+    void
+    write_view(const std::string& collection, const std::string& key, const string_view_t& blob,
+               const std::vector<std::string>& tags);
+
     virtual
     void
     remove(const std::string& collection, const std::string& key);
@@ -32,7 +32,8 @@ enum dispatch_errors {
     uncaught_error,
     resource_error,
     timeout_error,
-    deadline_error
+    deadline_error,
+    congestion_error
 };
 
 namespace aux {
@@ -61,6 +62,9 @@ class dispatch_category_t:
 
           case dispatch_errors::deadline_error:
             return "invocation deadline has passed";
+
+          case dispatch_errors::congestion_error:
+            return "outgoing backlog is over the high watermark";
         }
 
         return "cocaine.rpc.dispatch error";
@@ -68,6 +68,12 @@ struct decoder_t;
 template<class, class = encoder_t, class = decoder_t>
 struct channel;
 
+// Message and buffer pooling
+
+struct pooled_message_t;
+class buffer_pool_t;
+class message_pool_t;
+
 // Generic RPC objects
 
 class basic_dispatch_t;
@@ -60,7 +60,10 @@ struct resolve {
         unsigned int,
      /* A mapping between slot id numbers, message names and state transitions for both the message
         dispatch and upstream types to use in dynamic languages like Python, Ruby or JavaScript. */
-        graph_root_t
+        graph_root_t,
+     /* Path to the local UNIX domain socket of the service, if it's exposed on this host, which the
+        local clients might prefer over the endpoints above. Empty otherwise. */
+        optional<std::string>
     >::tag upstream_type;
 };
 
@@ -80,8 +83,13 @@ struct connect {
      /* Node ID. */
         std::string,
      /* A full dump of all available services on this node. Used by metalocator to aggregate
-        node information from the cluster. */
-        std::map<std::string, tuple::fold<protocol<resolve::upstream_type>::sequence_type>::type>
+        node information from the cluster. Same as the resolve() results, except for the local
+        socket paths, which are meaningless for other nodes. */
+        std::map<std::string, std::tuple<
+            std::vector<asio::ip::tcp::endpoint>,
+            unsigned int,
+            graph_root_t
+        >>
     >::tag upstream_type;
 };
 
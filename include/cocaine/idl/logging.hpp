@@ -23,6 +23,8 @@
 
 #include "cocaine/rpc/protocol.hpp"
 
+#include "cocaine/traits/view.hpp"
+
 #include <blackhole/attribute.hpp>
 
 namespace cocaine { namespace io {
@@ -46,10 +48,11 @@ struct emit {
         logging::priorities,
      /* Message source. Messages originating from the user code should be tagged with
         'app/<name>' so that they could be routed separately. */
-        std::string,
+        string_view_t,
      /* Log message. Some meaningful string, with no explicit limits on its length, although
-        underlying loggers might silently truncate it. */
-        std::string,
+        underlying loggers might silently truncate it. Both the source and the message are
+        borrowed right from the incoming frame, so filtered out messages are never copied. */
+        string_view_t,
      /* Log event attached attributes. */
         optional<blackhole::attribute::set_t>
     >::type argument_type;
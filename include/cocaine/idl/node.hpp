@@ -50,7 +50,11 @@ struct enqueue {
         do whatever it wants using these event names, for example handle every possible one. */
         std::string,
      /* Tag. Event can be enqueued to a specific worker with some user-defined name. */
-        optional<std::string>
+        optional<std::string>,
+     /* Execution policy, an object with the following optional fields: "urgent" flag, "priority"
+        level, "timeout" in seconds relative to the moment the event arrives and "tenant" name for
+        fair sharing between clients. */
+        optional<dynamic_t>
     >::type argument_type;
 
     typedef stream_of<
@@ -33,7 +33,11 @@ struct handshake {
     typedef rpc_tag tag;
 
     typedef boost::mpl::list<
-        /* peer id */ std::string
+        /* peer id */ std::string,
+        /* maximum shared ring capacity supported by the worker, zero if none */
+        optional<uint64_t>,
+        /* whether the worker understands rpc::cancel */
+        optional<bool>
     > argument_type;
 };
 
@@ -84,6 +88,60 @@ struct choke {
     typedef rpc_tag tag;
 };
 
+// Sent by the engine in response to a handshake, if both parties support shared rings. The memfd
+// with the rings is attached to this message via SCM_RIGHTS. From now on, session messages travel
+// through the rings, while the unix socket carries control messages, doorbells and those session
+// messages which don't fit into the rings.
+//
+// Every session message sent over the socket must be announced by an empty marker frame in the
+// ring, and the doorbell for the frames ahead of the marker must be rung before the message itself
+// is written. The receiver handles the ring frames up to the marker before the socket message, and
+// doesn't consume the ring past the marker until the socket message has been handled.
+struct rings {
+    typedef rpc_tag tag;
+
+    typedef boost::mpl::list<
+        /* ring capacity */ uint64_t
+    > argument_type;
+};
+
+// Notifies the peer that either there are new frames in its incoming ring, or there's free space in
+// its outgoing ring. Doorbells are only hints, the receiver might drain its incoming ring without
+// waiting for them, see above.
+struct doorbell {
+    typedef rpc_tag tag;
+};
+
+// Sent by the engine after the handshake, if large chunks might be handed off via memfds. Chunks of
+// at least this size might then be sent as blobs instead.
+struct handoff {
+    typedef rpc_tag tag;
+
+    typedef boost::mpl::list<
+        /* minimal blob size */ uint64_t
+    > argument_type;
+};
+
+// A chunk handed off via a memfd, which is attached to this message via SCM_RIGHTS. Always sent over
+// the unix socket, so with shared rings it must be announced by a marker frame like any other session
+// message sent over the socket, see rpc::rings. The receiver maps the memfd instead of reading the chunk through the socket. The
+// memfd must be sealed with F_SEAL_SHRINK and F_SEAL_WRITE, otherwise the blob is rejected.
+struct blob {
+    typedef rpc_tag tag;
+
+    typedef boost::mpl::list<
+        /* chunk size */ uint64_t
+    > argument_type;
+};
+
+// Sent by the engine when the client has gone away, but only to the workers which have announced the
+// support in the handshake. Such workers should abort the session and choke it as soon as possible
+// to free their concurrency slot. Sessions on the other workers just finish as if nothing happened,
+// with their output being dropped.
+struct cancel {
+    typedef rpc_tag tag;
+};
+
 }; // struct rpc
 
 template<>
@@ -99,7 +157,12 @@ struct protocol<rpc_tag> {
         rpc::invoke,
         rpc::chunk,
         rpc::error,
-        rpc::choke
+        rpc::choke,
+        rpc::rings,
+        rpc::doorbell,
+        rpc::handoff,
+        rpc::blob,
+        rpc::cancel
     > messages;
 
     typedef rpc scope;
@@ -23,6 +23,8 @@
 
 #include "cocaine/rpc/protocol.hpp"
 
+#include "cocaine/traits/view.hpp"
+
 namespace cocaine { namespace io {
 
 struct storage_tag;
@@ -66,8 +68,8 @@ struct write {
      /* Key. */
         std::string,
      /* Value. Typically, it should be serialized with msgpack, so that the future reader could
-        assume that it can be deserialized safely. */
-        std::string,
+        assume that it can be deserialized safely. Borrowed right from the incoming frame. */
+        bytes_view_t,
      /* Tag list. Imagine these are your indexes. */
         optional<std::vector<std::string>>
     >::type argument_type;
@@ -26,6 +26,7 @@
 
 #include <asio/io_service.hpp>
 #include <asio/ip/tcp.hpp>
+#include <asio/local/stream_protocol.hpp>
 
 namespace cocaine {
 
@@ -33,6 +34,8 @@ class actor_t {
     COCAINE_DECLARE_NONCOPYABLE(actor_t)
 
     class accept_action_t;
+    class local_accept_action_t;
+    class sharded_accept_action_t;
 
     context_t& m_context;
 
@@ -49,6 +52,15 @@ class actor_t {
     // allow concurrent observing and operations.
     synchronized<std::unique_ptr<asio::ip::tcp::acceptor>> m_acceptor;
 
+    // Sharded acceptors. When enabled, every execution unit accepts connections on its own reactor
+    // via a SO_REUSEPORT acceptor, while the acceptor above only holds the endpoint. Synchronized
+    // together with the acceptor above.
+    std::vector<std::shared_ptr<sharded_accept_action_t>> m_shards;
+
+    // Local acceptor for clients on the same host, bound to a UNIX domain socket under the runtime
+    // path. Optional. Synchronized together with the acceptor above.
+    std::unique_ptr<asio::local::stream_protocol::acceptor> m_local;
+
     // Main service thread.
     std::unique_ptr<io::chamber_t> m_chamber;
 
@@ -69,6 +81,10 @@ public:
     bool
     is_active() const;
 
+    // Path to the local UNIX domain socket, or an empty string if it's not exposed.
+    auto
+    local_endpoint() const -> std::string;
+
     auto
     prototype() const -> const io::basic_dispatch_t&;
 
@@ -0,0 +1,96 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef COCAINE_IO_BACKLOG_HPP
+#define COCAINE_IO_BACKLOG_HPP
+
+#include "cocaine/common.hpp"
+
+#include <atomic>
+
+namespace cocaine { namespace io {
+
+// Outgoing data backlog with high and low watermarks. The backlog becomes congested once it grows
+// above the high watermark, and stays congested until it drains down to the low watermark. It is
+// overflown once it grows above twice the high watermark. Zero high watermark disables the limit.
+
+class backlog_t {
+    COCAINE_DECLARE_NONCOPYABLE(backlog_t)
+
+    const size_t m_high;
+    const size_t m_low;
+
+    std::atomic<size_t> m_bytes;
+    std::atomic<bool> m_congested;
+
+public:
+    backlog_t(size_t high, size_t low):
+        m_high(high),
+        m_low(low),
+        m_bytes(0),
+        m_congested(false)
+    { }
+
+    bool
+    congested() const {
+        return m_congested.load(std::memory_order_acquire);
+    }
+
+    bool
+    overflown() const {
+        return m_high && size() > m_high * 2;
+    }
+
+    size_t
+    size() const {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+
+    void
+    acquire(size_t bytes) {
+        const size_t total = m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+        if(m_high && total > m_high) {
+            m_congested.store(true, std::memory_order_release);
+        }
+    }
+
+    // Returns whether the backlog has just drained down to the low watermark.
+    bool
+    release(size_t bytes) {
+        const size_t total = m_bytes.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+
+        if(total > m_low || !m_congested.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+
+        // A concurrent acquire() might have grown the backlog above the high watermark after it has
+        // been sampled above, in which case its congestion flag could have been cleared right now.
+        if(m_high && size() > m_high) {
+            m_congested.store(true, std::memory_order_release);
+            return false;
+        }
+
+        return true;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
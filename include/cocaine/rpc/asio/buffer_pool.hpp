@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_BUFFER_POOL_HPP
+#define COCAINE_IO_BUFFER_POOL_HPP
+
+#include "cocaine/common.hpp"
+
+#include <array>
+#include <mutex>
+
+namespace cocaine { namespace io {
+
+// Contiguous chunk of memory for incoming data.
+
+struct slab_t {
+    char*  data;
+    size_t size;
+};
+
+// Size-classed free lists of read buffers. Slabs are always powers of two, starting from kMinimumSlabSize,
+// and slabs larger than the largest size class are not pooled at all. Streams might be destroyed on any thread,
+// so the free lists are synchronized.
+
+class buffer_pool_t {
+    COCAINE_DECLARE_NONCOPYABLE(buffer_pool_t)
+
+    static const size_t kMinimumSlabSize = 4096;
+    static const size_t kSizeClasses     = 11;
+
+    // Maximum total size of idle slabs kept in every size class.
+    static const size_t kMaximumClassSize = 4194304;
+
+    std::mutex m_mutex;
+    std::array<std::vector<char*>, kSizeClasses> m_slabs;
+
+public:
+    buffer_pool_t() { }
+
+   ~buffer_pool_t() {
+        for(auto it = m_slabs.begin(); it != m_slabs.end(); ++it) {
+            for(auto slab = it->begin(); slab != it->end(); ++slab) {
+                delete[] *slab;
+            }
+        }
+    }
+
+    // Acquires a slab of at least the specified size.
+    auto
+    acquire(size_t size) -> slab_t {
+        slab_t slab = { nullptr, kMinimumSlabSize };
+
+        size_t index = 0;
+
+        while(slab.size < size) {
+            slab.size *= 2;
+            index++;
+        }
+
+        if(index < kSizeClasses) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+
+            if(!m_slabs[index].empty()) {
+                slab.data = m_slabs[index].back();
+                m_slabs[index].pop_back();
+            }
+        }
+
+        if(slab.data == nullptr) {
+            slab.data = new char[slab.size];
+        }
+
+        return slab;
+    }
+
+    void
+    release(const slab_t& slab) {
+        size_t index = 0;
+
+        while((kMinimumSlabSize << index) < slab.size) {
+            index++;
+        }
+
+        if(index < kSizeClasses) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+
+            if(m_slabs[index].size() * slab.size < kMaximumClassSize) {
+                return m_slabs[index].push_back(slab.data);
+            }
+        }
+
+        delete[] slab.data;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
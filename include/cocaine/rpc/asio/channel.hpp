@@ -37,9 +37,10 @@ struct channel {
     typedef typename protocol_type::socket socket_type;
 
     explicit
-    channel(std::unique_ptr<socket_type> socket_):
+    channel(std::unique_ptr<socket_type> socket_,
+            const std::shared_ptr<buffer_pool_t>& pool = std::shared_ptr<buffer_pool_t>()):
         socket(std::move(socket_)),
-        reader(new readable_stream<protocol_type, decoder_type>(socket)),
+        reader(new readable_stream<protocol_type, decoder_type>(socket, pool)),
         writer(new writable_stream<protocol_type, encoder_type>(socket))
     {
         socket->non_blocking(true);
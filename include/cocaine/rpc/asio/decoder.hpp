@@ -24,6 +24,7 @@
 #include "cocaine/rpc/asio/errors.hpp"
 
 #include "cocaine/traits.hpp"
+#include "cocaine/traits/tuple.hpp"
 
 namespace cocaine { namespace io {
 
@@ -31,6 +32,77 @@ struct decoder_t;
 
 namespace aux {
 
+// Every decoded frame gets its own arena, so that the memory occupied by the unpacked objects can
+// be released as soon as the frame is handled instead of piling up in a connection-wide zone. Arenas
+// are cleared and recycled, but no more than kMaximumPoolSize of them are kept for later reuse.
+
+class zone_pool_t {
+    COCAINE_DECLARE_NONCOPYABLE(zone_pool_t)
+
+    static const size_t kMaximumPoolSize = 16;
+
+    // Frame arenas only hold the top-level framing and argument arrays, while strings point directly
+    // into the read buffer, so there's no need for large chunks.
+    static const size_t kInitialChunkSize = 1024;
+
+    std::vector<std::unique_ptr<msgpack::zone>> m_zones;
+
+public:
+    zone_pool_t() = default;
+
+    auto
+    acquire() -> std::unique_ptr<msgpack::zone> {
+        if(m_zones.empty()) {
+            return std::make_unique<msgpack::zone>(kInitialChunkSize);
+        }
+
+        auto zone = std::move(m_zones.back());
+        m_zones.pop_back();
+
+        return zone;
+    }
+
+    void
+    recycle(std::unique_ptr<msgpack::zone> zone) {
+        if(!zone || m_zones.size() >= kMaximumPoolSize) {
+            return;
+        }
+
+        // Drops all the chunks but the initial one, so recycled arenas don't grow over time.
+        zone->clear();
+
+        m_zones.emplace_back(std::move(zone));
+    }
+
+    auto
+    size() const -> size_t {
+        return m_zones.size();
+    }
+};
+
+// Size of the packed array header or unsigned integer starting with the specified byte.
+
+inline
+size_t
+packed_header_size(unsigned char byte) {
+    if(byte <= 0x7F || (byte >= 0x90 && byte <= 0x9F)) {
+        return 1;
+    }
+
+    switch(byte) {
+    case 0xCC: case 0xD0:
+        return 2;
+    case 0xCD: case 0xD1: case 0xDC:
+        return 3;
+    case 0xCE: case 0xD2: case 0xDD:
+        return 5;
+    case 0xCF: case 0xD3:
+        return 9;
+    default:
+        return 0;
+    }
+}
+
 struct decoded_message_t {
     friend struct io::decoder_t;
 
@@ -49,8 +121,23 @@ struct decoded_message_t {
         return object.via.array.ptr[2];
     }
 
+    // The argument sequence exactly as it was packed by the peer, so that it can be forwarded further
+    // without unpacking it. Points into the decoded buffer and therefore shares its lifetime. Empty if
+    // the frame has any trailing elements after the arguments.
+    auto
+    packed_args() const -> raw_sequence_t {
+        return raw_sequence_t { packed, packed_size };
+    }
+
 private:
     msgpack::object object;
+
+    const char * packed;
+    size_t packed_size;
+
+    // The arena the object above was unpacked into. Handed back to the pool when the message slot
+    // is reused for the next frame.
+    std::unique_ptr<msgpack::zone> zone;
 };
 
 } // namespace aux
@@ -67,7 +154,18 @@ struct decoder_t {
     decode(const char* data, size_t size, message_type& message, std::error_code& ec) {
         size_t offset = 0;
 
-        msgpack::unpack_return rv = msgpack::unpack(data, size, &offset, &zone, &message.object);
+        message.packed = nullptr;
+        message.packed_size = 0;
+
+        if(!message.zone) {
+            message.zone = pool.acquire();
+        } else {
+            // The previous frame is no longer needed, so its arena can be reused right away.
+            message.zone->clear();
+        }
+
+        msgpack::unpack_return rv = msgpack::unpack(data, size, &offset, message.zone.get(),
+            &message.object);
 
         if(rv == msgpack::UNPACK_SUCCESS || rv == msgpack::UNPACK_EXTRA_BYTES) {
             if(message.object.type != msgpack::type::ARRAY || message.object.via.array.size < 3) {
@@ -77,6 +175,17 @@ struct decoder_t {
                       message.object.via.array.ptr[2].type != msgpack::type::ARRAY)
             {
                 ec = error::frame_format_error;
+            } else if(message.object.via.array.size == 3) {
+                size_t header = 0;
+
+                // Skip the array header, the span and the message type. All of them have just been
+                // validated by the unpacker, so the sizes are known to be sane.
+                for(int i = 0; i < 3; ++i) {
+                    header += aux::packed_header_size(data[header]);
+                }
+
+                message.packed = data + header;
+                message.packed_size = offset - header;
             }
         } else if(rv == msgpack::UNPACK_CONTINUE) {
             ec = error::insufficient_bytes;
@@ -87,8 +196,14 @@ struct decoder_t {
         return offset;
     }
 
+    // Returns the message arena back to the pool once the message is completely handled.
+    void
+    recycle(message_type& message) {
+        pool.recycle(std::move(message.zone));
+    }
+
 private:
-    msgpack::zone zone;
+    aux::zone_pool_t pool;
 };
 
 }} // namespace cocaine::io
@@ -89,6 +89,17 @@ struct encoded_message_t {
         return buffer.offset;
     }
 
+    size_t
+    capacity() const {
+        return buffer.vector.size();
+    }
+
+    // Drops the encoded data, but keeps the buffer for reuse.
+    void
+    clear() {
+        buffer.offset = 0;
+    }
+
 private:
     encoded_buffers_t buffer;
 };
@@ -101,7 +112,17 @@ struct encoded:
 {
     template<class... Args>
     encoded(uint64_t span, Args&&... args) {
-        msgpack::packer<aux::encoded_buffers_t> packer(buffer);
+        encode(*this, span, std::forward<Args>(args)...);
+    }
+
+    // Encodes the message into an existing message object, reusing its buffer.
+    template<class... Args>
+    static
+    void
+    encode(aux::encoded_message_t& message, uint64_t span, Args&&... args) {
+        message.clear();
+
+        msgpack::packer<aux::encoded_buffers_t> packer(message.buffer);
 
         packer.pack_array(3);
 
@@ -0,0 +1,161 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef COCAINE_IO_MESSAGE_POOL_HPP
+#define COCAINE_IO_MESSAGE_POOL_HPP
+
+#include "cocaine/rpc/asio/encoder.hpp"
+
+#include <atomic>
+#include <mutex>
+
+namespace cocaine { namespace io {
+
+// Outgoing message along with its write queue link. Messages are recycled together with their
+// encoding buffers, so once the pool is warmed up, the outgoing message path doesn't allocate.
+
+struct pooled_message_t {
+    COCAINE_DECLARE_NONCOPYABLE(pooled_message_t)
+
+    pooled_message_t():
+        next(nullptr)
+    { }
+
+    encoder_t::message_type message;
+
+    // Keeps whatever owns the message alive until it is written.
+    std::shared_ptr<void> owner;
+
+    // Intrusive queue link.
+    pooled_message_t* next;
+};
+
+// Free list of outgoing messages. Messages might be encoded on any thread, while they are usually
+// recycled on the thread which does the actual I/O. Every thread keeps a small cache of messages, so
+// that acquiring and recycling them doesn't take any locks. The pool itself is only touched when the
+// cache of some thread runs dry or overflows, and then messages are moved in batches.
+//
+// Messages aren't tied to any pool, so the thread caches are shared between all the pools.
+
+class message_pool_t {
+    COCAINE_DECLARE_NONCOPYABLE(message_pool_t)
+
+    static const size_t kMaximumPoolSize   = 1024;
+    static const size_t kMaximumBufferSize = 65536;
+
+    // Number of messages moved between the pool and the thread caches at once.
+    static const size_t kBatchSize = 32;
+
+    std::mutex m_mutex;
+
+    pooled_message_t* m_head;
+    size_t m_size;
+
+public:
+    message_pool_t():
+        m_head(nullptr),
+        m_size(0)
+    { }
+
+   ~message_pool_t() {
+        while(m_head) {
+            pooled_message_t* next = m_head->next;
+            delete m_head;
+            m_head = next;
+        }
+    }
+
+    auto
+    acquire() -> std::unique_ptr<pooled_message_t>;
+
+    void
+    recycle(std::unique_ptr<pooled_message_t> message);
+};
+
+// Lock-free multi-producer single-consumer queue of outgoing messages. Producers push messages onto
+// an intrusive stack, while the consumer takes the whole stack at once and reverses it, so there's no
+// ABA problem. The queue also tracks whether the consumer is already scheduled to drain it, so that
+// producers wake it up at most once per batch.
+
+class outbound_queue_t {
+    COCAINE_DECLARE_NONCOPYABLE(outbound_queue_t)
+
+    std::atomic<pooled_message_t*> m_head;
+    std::atomic<bool> m_scheduled;
+
+public:
+    outbound_queue_t():
+        m_head(nullptr),
+        m_scheduled(false)
+    { }
+
+   ~outbound_queue_t() {
+        // NOTE: Normally, the consumer drains the queue into the pool before destruction.
+        for(pooled_message_t* message = drain(); message;) {
+            pooled_message_t* next = message->next;
+            delete message;
+            message = next;
+        }
+    }
+
+    // Returns whether the consumer has to be scheduled to drain the queue.
+    bool
+    push(std::unique_ptr<pooled_message_t> message) {
+        pooled_message_t* ptr = message.release();
+
+        ptr->next = m_head.load(std::memory_order_relaxed);
+
+        while(!m_head.compare_exchange_weak(ptr->next, ptr)) {
+            // Retry with the updated head.
+        }
+
+        return !m_scheduled.exchange(true);
+    }
+
+    // Takes all the queued messages at once, in the order they were pushed.
+    auto
+    drain() -> pooled_message_t* {
+        // Reset the flag before taking the messages, so that the messages pushed afterwards would
+        // trigger another wakeup.
+        m_scheduled.store(false);
+
+        pooled_message_t* head = m_head.exchange(nullptr);
+        pooled_message_t* result = nullptr;
+
+        while(head) {
+            pooled_message_t* next = head->next;
+
+            head->next = result;
+            result = head;
+            head = next;
+        }
+
+        return result;
+    }
+
+    // Should be called if the consumer couldn't be scheduled after all.
+    void
+    cancel() {
+        m_scheduled.store(false);
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
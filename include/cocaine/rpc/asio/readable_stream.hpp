@@ -21,19 +21,39 @@
 #ifndef COCAINE_IO_BUFFERED_READABLE_STREAM_HPP
 #define COCAINE_IO_BUFFERED_READABLE_STREAM_HPP
 
+#include "cocaine/rpc/asio/buffer_pool.hpp"
 #include "cocaine/rpc/asio/errors.hpp"
 
+#include <deque>
 #include <functional>
 
 #include <asio/io_service.hpp>
 #include <asio/basic_stream_socket.hpp>
+#include <asio/local/stream_protocol.hpp>
 
 #include <cstring>
 
+#include <sys/socket.h>
+#include <unistd.h>
+
 namespace cocaine { namespace io {
 
 namespace ph = std::placeholders;
 
+// Local sockets might carry descriptors attached to the data via SCM_RIGHTS, which are only received
+// by recvmsg(), so reads from them are done manually once the socket becomes readable. Only streams
+// which have explicitly enabled it receive descriptors, for the others the kernel closes them.
+
+template<class Protocol>
+struct carries_descriptors:
+    public std::false_type
+{ };
+
+template<>
+struct carries_descriptors<asio::local::stream_protocol>:
+    public std::true_type
+{ };
+
 template<class Protocol, class Decoder>
 class readable_stream:
     public std::enable_shared_from_this<readable_stream<Protocol, Decoder>>
@@ -42,6 +62,14 @@ class readable_stream:
 
     static const size_t kInitialBufferSize = 65536;
 
+    // Maximum number of frames handed over to the handler at once by the batched read operation.
+    static const size_t kMaximumBatchSize = 16;
+
+    // Maximum number of descriptors received at once, and kept until taken over. Peers which don't
+    // expect any descriptors never take them over, so the excess is closed right away.
+    static const size_t kMaximumDescriptors = 16;
+    static const size_t kMaximumPendingDescriptors = 64;
+
     typedef typename Protocol::socket channel_type;
 
     typedef Decoder decoder_type;
@@ -51,27 +79,54 @@ class readable_stream:
 
     typedef std::function<void(const std::error_code&)> handler_type;
 
-    std::vector<char, uninitialized<char>> m_ring;
-    std::vector<char, uninitialized<char>>::size_type m_rd_offset, m_rx_offset;
+    // Read buffers are drawn from this pool, if any, or from the heap otherwise.
+    const std::shared_ptr<buffer_pool_t> m_pool;
+
+    // The ring is only attached while the socket is hot, i.e. while there's some unprocessed data in
+    // it, or while more data can be read right away. Once everything is consumed and the socket has
+    // nothing more to read, or once the stream fails, the ring is handed back to the pool.
+    slab_t m_ring;
+    size_t m_rd_offset, m_rx_offset;
 
     decoder_type m_decoder;
 
+    // Whether the descriptors are received at all, and the descriptors received along with the data,
+    // in the order they were sent.
+    bool m_passing;
+    std::deque<int> m_descriptors;
+
 public:
+    typedef std::vector<message_type> batch_type;
+
     explicit
-    readable_stream(const std::shared_ptr<channel_type>& channel):
-        m_channel(channel)
+    readable_stream(const std::shared_ptr<channel_type>& channel,
+                    const std::shared_ptr<buffer_pool_t>& pool = std::shared_ptr<buffer_pool_t>()):
+        m_channel(channel),
+        m_pool(pool),
+        m_passing(false)
     {
-        m_ring.resize(kInitialBufferSize);
+        m_ring.data = nullptr;
+        m_ring.size = 0;
         m_rd_offset = m_rx_offset = 0;
     }
 
+   ~readable_stream() {
+        if(m_ring.data) {
+            release(m_ring);
+        }
+
+        for(auto it = m_descriptors.begin(); it != m_descriptors.end(); ++it) {
+            ::close(*it);
+        }
+    }
+
     void
     read(message_type& message, handler_type handle) {
         std::error_code ec;
 
         const size_t
             bytes_pending = m_rd_offset - m_rx_offset,
-            bytes_decoded = m_decoder.decode(m_ring.data() + m_rx_offset, bytes_pending, message, ec);
+            bytes_decoded = m_decoder.decode(m_ring.data + m_rx_offset, bytes_pending, message, ec);
 
         if(ec != error::insufficient_bytes) {
             if(!ec) {
@@ -81,32 +136,138 @@ public:
             return m_channel->get_io_service().post(std::bind(handle, ec));
         }
 
-        if(m_rx_offset) {
-            // Compactify the ring before the asynchronous read operation.
-            std::memmove(m_ring.data(), m_ring.data() + m_rx_offset, bytes_pending);
+        compact();
+        receive(message, handle);
+    }
 
-            m_rd_offset = bytes_pending;
-            m_rx_offset = 0;
-        }
+    // Batched read operation. Decodes every complete frame available in the ring, up to a limit, and
+    // invokes the handler once for the whole batch. Messages in the batch reference the ring, so they
+    // are only valid until the next read operation on this stream.
 
-        if(bytes_pending * 2 >= m_ring.size()) {
-            // The total size of unprocessed data in larger than half the size of the ring, so grow
-            // the ring in order to accomodate more data.
-            m_ring.resize(m_ring.size() * 2);
+    void
+    read(batch_type& batch, handler_type handle) {
+        drain(batch, handle, false);
+    }
+
+    // Hands the message arena back to the decoder once the message is no longer needed.
+    void
+    recycle(message_type& message) {
+        m_decoder.recycle(message);
+    }
+
+    void
+    recycle(batch_type& batch) {
+        for(auto it = batch.begin(); it != batch.end(); ++it) {
+            m_decoder.recycle(*it);
         }
 
-        m_channel->async_read_some(
-            asio::buffer(m_ring.data() + m_rd_offset, m_ring.size() - m_rd_offset),
-            std::bind(&readable_stream::fill, this->shared_from_this(), std::ref(message), handle, ph::_1, ph::_2)
-        );
+        batch.clear();
     }
 
     auto
     pressure() const -> size_t {
-        return m_ring.size();
+        return m_ring.size;
+    }
+
+    // Starts receiving the descriptors attached to the data. Only for peers which are expected to send
+    // them, since the received descriptors are kept until taken over. No-op for non-local sockets.
+    void
+    enable_descriptors() {
+        m_passing = carries_descriptors<Protocol>::value;
+    }
+
+    // Takes over the oldest received descriptor, or returns -1 if there's none. Descriptors arrive
+    // along with the first byte of the message they're attached to, so they're always available by
+    // the time that message is decoded.
+    int
+    descriptor() {
+        if(m_descriptors.empty()) {
+            return -1;
+        }
+
+        const int fd = m_descriptors.front();
+        m_descriptors.pop_front();
+
+        return fd;
     }
 
 private:
+    template<class Target>
+    void
+    receive(Target& target, handler_type handle) {
+        void (readable_stream::*complete)(Target&, handler_type, const std::error_code&, size_t) =
+            &readable_stream::fill;
+
+        if(m_ring.data && m_rd_offset == 0) {
+            std::error_code error;
+
+            // Everything has been consumed, so check whether the socket is still hot. If it is, the
+            // ring is kept and the data is handled without another round-trip through the reactor.
+            const size_t bytes_read = read_some(m_ring.data, m_ring.size, error);
+
+            if(error != asio::error::would_block && error != asio::error::try_again) {
+                if(error) {
+                    discard();
+                    return m_channel->get_io_service().post(std::bind(handle, error));
+                }
+
+                m_rd_offset += bytes_read;
+
+                return proceed(target, handle);
+            }
+
+            // The socket has gone cold, so hand the ring back until it becomes readable again.
+            discard();
+        }
+
+        if(m_ring.data == nullptr || m_passing) {
+            // Nothing is pending, so wait for the socket to become readable without holding a buffer.
+            return m_channel->async_read_some(
+                asio::null_buffers(),
+                std::bind(&readable_stream::ready<Target>, this->shared_from_this(), std::ref(target), handle, ph::_1)
+            );
+        }
+
+        m_channel->async_read_some(
+            asio::buffer(m_ring.data + m_rd_offset, m_ring.size - m_rd_offset),
+            std::bind(complete, this->shared_from_this(), std::ref(target), handle, ph::_1, ph::_2)
+        );
+    }
+
+    template<class Target>
+    void
+    ready(Target& target, handler_type handle, const std::error_code& ec) {
+        if(ec) {
+            if(ec == asio::error::operation_aborted) {
+                return;
+            }
+
+            discard();
+
+            return m_channel->get_io_service().post(std::bind(handle, ec));
+        }
+
+        if(m_ring.data == nullptr) {
+            m_ring = acquire(kInitialBufferSize);
+        }
+
+        std::error_code error;
+
+        // The socket is non-blocking, so this never blocks, but the readiness might be spurious.
+        const size_t bytes_read = read_some(m_ring.data + m_rd_offset, m_ring.size - m_rd_offset,
+            error);
+
+        if(error == asio::error::would_block || error == asio::error::try_again) {
+            if(m_rd_offset == 0) {
+                discard();
+            }
+
+            return receive(target, handle);
+        }
+
+        fill(target, handle, error, bytes_read);
+    }
+
     void
     fill(message_type& message, handler_type handle, const std::error_code& ec, size_t bytes_read) {
         if(ec) {
@@ -114,6 +275,8 @@ private:
                 return;
             }
 
+            discard();
+
             return m_channel->get_io_service().post(std::bind(handle, ec));
         }
 
@@ -121,6 +284,231 @@ private:
 
         read(std::ref(message), handle);
     }
+
+    void
+    fill(batch_type& batch, handler_type handle, const std::error_code& ec, size_t bytes_read) {
+        if(ec) {
+            if(ec == asio::error::operation_aborted) {
+                return;
+            }
+
+            discard();
+
+            return m_channel->get_io_service().post(std::bind(handle, ec));
+        }
+
+        m_rd_offset += bytes_read;
+
+        // This is already a completion handler, so the batch can be handled right away without
+        // another round-trip through the reactor.
+        drain(batch, handle, true);
+    }
+
+    // Continues the read operation once some data is read outside of a completion handler, so the
+    // handler is never invoked right away, which would otherwise recurse while the socket is hot.
+
+    void
+    proceed(message_type& message, handler_type handle) {
+        read(message, handle);
+    }
+
+    void
+    proceed(batch_type& batch, handler_type handle) {
+        drain(batch, handle, false);
+    }
+
+    void
+    drain(batch_type& batch, handler_type handle, bool immediate) {
+        std::error_code ec;
+
+        // Previous batch is handled by now, so its arenas can be reused for the new one.
+        recycle(batch);
+
+        while(batch.size() < kMaximumBatchSize) {
+            batch.emplace_back();
+
+            const size_t
+                bytes_pending = m_rd_offset - m_rx_offset,
+                bytes_decoded = m_decoder.decode(m_ring.data + m_rx_offset, bytes_pending, batch.back(), ec);
+
+            if(ec) {
+                m_decoder.recycle(batch.back());
+                batch.pop_back();
+                break;
+            }
+
+            m_rx_offset += bytes_decoded;
+        }
+
+        if(!batch.empty()) {
+            // NOTE: Decoding errors, if any, will be reported on the next read operation, after all
+            // the successfully decoded frames are handled.
+            if(immediate) {
+                return handle(std::error_code());
+            }
+
+            return m_channel->get_io_service().post(std::bind(handle, std::error_code()));
+        }
+
+        if(ec != error::insufficient_bytes) {
+            return m_channel->get_io_service().post(std::bind(handle, ec));
+        }
+
+        compact();
+        receive(batch, handle);
+    }
+
+    size_t
+    read_some(char* data, size_t size, std::error_code& ec) {
+        if(m_passing) {
+            return read_some(data, size, ec, std::true_type());
+        } else {
+            return read_some(data, size, ec, std::false_type());
+        }
+    }
+
+    size_t
+    read_some(char* data, size_t size, std::error_code& ec, std::false_type) {
+        return m_channel->read_some(asio::buffer(data, size), ec);
+    }
+
+    size_t
+    read_some(char* data, size_t size, std::error_code& ec, std::true_type) {
+        struct iovec iov;
+
+        iov.iov_base = data;
+        iov.iov_len  = size;
+
+        char control[CMSG_SPACE(sizeof(int) * kMaximumDescriptors)];
+
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+
+        message.msg_iov        = &iov;
+        message.msg_iovlen     = 1;
+        message.msg_control    = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t bytes_read;
+
+#if defined(MSG_CMSG_CLOEXEC)
+        const int flags = MSG_CMSG_CLOEXEC;
+#else
+        const int flags = 0;
+#endif
+
+        do {
+            bytes_read = ::recvmsg(m_channel->native_handle(), &message, flags);
+        } while(bytes_read == -1 && errno == EINTR);
+
+        if(bytes_read == -1) {
+            ec = std::error_code(errno, std::system_category());
+            return 0;
+        } else if(bytes_read == 0) {
+            ec = asio::error::eof;
+            return 0;
+        }
+
+        for(struct cmsghdr* it = CMSG_FIRSTHDR(&message); it; it = CMSG_NXTHDR(&message, it)) {
+            if(it->cmsg_level != SOL_SOCKET || it->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+
+            const size_t count = (it->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+            for(size_t i = 0; i < count; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(it) + i * sizeof(int), sizeof(int));
+
+                if(m_descriptors.size() < kMaximumPendingDescriptors) {
+                    m_descriptors.push_back(fd);
+                } else {
+                    ::close(fd);
+                }
+            }
+        }
+
+        if(message.msg_flags & MSG_CTRUNC) {
+            // Some descriptors were dropped by the kernel, so the stream can't be trusted anymore.
+            ec = std::make_error_code(std::errc::no_buffer_space);
+        }
+
+        return static_cast<size_t>(bytes_read);
+    }
+
+    void
+    compact() {
+        const size_t bytes_pending = m_rd_offset - m_rx_offset;
+
+        if(bytes_pending == 0) {
+            if(m_ring.size > kInitialBufferSize) {
+                // Some large frame has been consumed, so don't keep the oversized ring around.
+                return discard();
+            }
+
+            // Everything is consumed, but the ring is kept in case the socket is still hot, see
+            // receive().
+            m_rd_offset = m_rx_offset = 0;
+            return;
+        }
+
+        size_t size = m_ring.size;
+
+        if(bytes_pending * 2 >= m_ring.size) {
+            // The total size of unprocessed data in larger than half the size of the ring, so grow
+            // the ring in order to accomodate more data.
+            size = m_ring.size * 2;
+        } else if(m_ring.size > kInitialBufferSize && bytes_pending * 2 < kInitialBufferSize) {
+            // Some large frame has been consumed, so shrink the ring back.
+            size = kInitialBufferSize;
+        }
+
+        if(size != m_ring.size) {
+            const slab_t ring = acquire(size);
+
+            std::memcpy(ring.data, m_ring.data + m_rx_offset, bytes_pending);
+
+            release(m_ring);
+            m_ring = ring;
+        } else if(m_rx_offset) {
+            // Compactify the ring before the asynchronous read operation.
+            std::memmove(m_ring.data, m_ring.data + m_rx_offset, bytes_pending);
+        }
+
+        m_rd_offset = bytes_pending;
+        m_rx_offset = 0;
+    }
+
+    void
+    discard() {
+        if(m_ring.data) {
+            release(m_ring);
+        }
+
+        m_ring.data = nullptr;
+        m_ring.size = 0;
+        m_rd_offset = m_rx_offset = 0;
+    }
+
+    auto
+    acquire(size_t size) -> slab_t {
+        if(m_pool) {
+            return m_pool->acquire(size);
+        }
+
+        const slab_t slab = { new char[size], size };
+
+        return slab;
+    }
+
+    void
+    release(const slab_t& slab) {
+        if(m_pool) {
+            return m_pool->release(slab);
+        }
+
+        delete[] slab.data;
+    }
 };
 
 }} // namespace cocaine::io
@@ -29,11 +29,60 @@
 #include <asio/basic_stream_socket.hpp>
 
 #include <deque>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 namespace cocaine { namespace io {
 
 namespace ph = std::placeholders;
 
+namespace aux {
+
+// TCP_CORK is only meaningful for TCP sockets on Linux, for other sockets setting it simply fails,
+// and this failure is ignored.
+
+struct cork_t {
+    explicit
+    cork_t(bool enable):
+        value(enable ? 1 : 0)
+    { }
+
+    template<class Protocol>
+    int
+    level(const Protocol&) const {
+        return IPPROTO_TCP;
+    }
+
+    template<class Protocol>
+    int
+    name(const Protocol&) const {
+#if defined(TCP_CORK)
+        return TCP_CORK;
+#else
+        return -1;
+#endif
+    }
+
+    template<class Protocol>
+    const int*
+    data(const Protocol&) const {
+        return &value;
+    }
+
+    template<class Protocol>
+    size_t
+    size(const Protocol&) const {
+        return sizeof(value);
+    }
+
+private:
+    int value;
+};
+
+} // namespace aux
+
 template<class Protocol, class Encoder>
 class writable_stream:
     public std::enable_shared_from_this<writable_stream<Protocol, Encoder>>
@@ -52,19 +101,82 @@ class writable_stream:
     std::deque<asio::const_buffer> m_messages;
     std::deque<handler_type> m_handlers;
 
-    enum class states { idle, flushing } m_state;
+    // Stream-wide completion handler for messages written without their own handlers.
+    handler_type m_handle;
+
+    enum class states { idle, pending, flushing } m_state;
+
+    // Batching mode limits. When enabled, messages written within one reactor turn are gathered into
+    // a single write operation bounded by these limits, instead of being written one by one.
+    struct {
+        size_t bytes;
+        size_t count;
+        bool   cork;
+    } m_batching;
+
+    // Reusable scatter-gather list for batched writes.
+    std::vector<asio::const_buffer> m_gather;
+
+    // Whether the socket is currently corked. It stays corked until the queue drains.
+    bool m_corked;
 
 public:
     explicit
     writable_stream(const std::shared_ptr<channel_type>& channel):
         m_channel(channel),
-        m_state(states::idle)
-    { }
+        m_state(states::idle),
+        m_corked(false)
+    {
+        m_batching.bytes = 0;
+        m_batching.count = 0;
+        m_batching.cork  = false;
+    }
+
+    // Enables the batching mode. Zero count disables it.
+    void
+    batch(size_t bytes, size_t count, bool cork) {
+        m_batching.bytes = bytes;
+        m_batching.count = count;
+        m_batching.cork  = cork;
+
+        m_gather.reserve(count);
+    }
+
+    // Sets the stream-wide completion handler. It is invoked once per message written without its
+    // own handler, in the order of writes, which saves a closure per message.
+    void
+    bind(handler_type handle) {
+        m_handle = handle;
+    }
+
+    void
+    write(const message_type& message) {
+        write(message, handler_type());
+    }
 
     void
     write(const message_type& message, handler_type handle) {
         size_t bytes_written = 0;
 
+        if(m_batching.count) {
+            m_messages.emplace_back(message.data(), message.size());
+            m_handlers.emplace_back(handle);
+
+            if(m_state == states::idle) {
+                m_state = states::pending;
+
+                cork(true);
+
+                // The actual write will happen after all the handlers queued within this reactor turn
+                // have had their chance to write their messages too.
+                m_channel->get_io_service().post(std::bind(&writable_stream::gather,
+                    this->shared_from_this()
+                ));
+            }
+
+            return;
+        }
+
         if(m_state == states::idle) {
             std::error_code ec;
 
@@ -72,7 +184,7 @@ public:
             bytes_written = m_channel->write_some(asio::buffer(message.data(), message.size()), ec);
 
             if(!ec && bytes_written == message.size()) {
-                return m_channel->get_io_service().post(std::bind(handle, ec));
+                return notify(handle, ec);
             }
         }
 
@@ -101,6 +213,73 @@ public:
     }
 
 private:
+    void
+    gather() {
+        if(m_state != states::pending) {
+            return;
+        }
+
+        const size_t bytes_gathered = fill();
+
+        std::error_code ec;
+
+        const size_t bytes_written = m_channel->write_some(m_gather, ec);
+
+        if(ec && ec != asio::error::would_block && ec != asio::error::try_again) {
+            m_state = states::flushing;
+            return flush(ec, 0);
+        }
+
+        consume(bytes_written);
+
+        if(m_messages.empty()) {
+            m_state = states::idle;
+            return cork(false);
+        }
+
+        if(bytes_written == bytes_gathered) {
+            // Everything gathered so far was written, but there are more messages pending due to the
+            // batching limits, so gather the next batch. The socket stays corked meanwhile.
+            m_channel->get_io_service().post(std::bind(&writable_stream::gather,
+                this->shared_from_this()
+            ));
+
+            return;
+        }
+
+        // The socket buffer is full, so wait for it to drain.
+        m_state = states::flushing;
+
+        fill();
+
+        m_channel->async_write_some(
+            m_gather,
+            std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
+        );
+    }
+
+    // Fills the scatter-gather list with the queued messages up to the configured batching limits,
+    // but at least one message. Returns the number of bytes gathered.
+    size_t
+    fill() {
+        size_t bytes_gathered = 0;
+
+        m_gather.clear();
+
+        for(auto it = m_messages.begin(); it != m_messages.end(); ++it) {
+            if(m_gather.size() == m_batching.count ||
+              (m_batching.bytes && !m_gather.empty() && bytes_gathered + asio::buffer_size(*it) > m_batching.bytes))
+            {
+                break;
+            }
+
+            bytes_gathered += asio::buffer_size(*it);
+            m_gather.push_back(*it);
+        }
+
+        return bytes_gathered;
+    }
+
     void
     flush(const std::error_code& ec, size_t bytes_written) {
         if(ec) {
@@ -109,7 +288,7 @@ private:
             }
 
             while(!m_handlers.empty()) {
-                m_channel->get_io_service().post(std::bind(m_handlers.front(), ec));
+                notify(m_handlers.front(), ec);
 
                 m_messages.pop_front();
                 m_handlers.pop_front();
@@ -118,6 +297,31 @@ private:
             return;
         }
 
+        consume(bytes_written);
+
+        if(m_messages.empty() && m_state == states::flushing) {
+            m_state = states::idle;
+            return cork(false);
+        }
+
+        if(m_batching.count) {
+            // Every gather is bounded by the batching limits, not only the first one.
+            fill();
+
+            m_channel->async_write_some(
+                m_gather,
+                std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
+            );
+        } else {
+            m_channel->async_write_some(
+                m_messages,
+                std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
+            );
+        }
+    }
+
+    void
+    consume(size_t bytes_written) {
         while(bytes_written) {
             BOOST_ASSERT(!m_messages.empty() && !m_handlers.empty());
 
@@ -131,21 +335,38 @@ private:
             bytes_written -= message_size;
 
             // Queue this block's handler for invocation.
-            m_channel->get_io_service().post(std::bind(m_handlers.front(), ec));
+            notify(m_handlers.front(), std::error_code());
 
             m_messages.pop_front();
             m_handlers.pop_front();
         }
+    }
 
-        if(m_messages.empty() && m_state == states::flushing) {
-            m_state = states::idle;
+    void
+    notify(const handler_type& handle, const std::error_code& ec) {
+        if(handle) {
+            m_channel->get_io_service().post(std::bind(handle, ec));
+        } else if(!ec) {
+            // Successful completions are reported right away, because the stream-wide handler only
+            // releases the written messages and never writes anything back to the stream.
+            m_handle(ec);
+        } else {
+            m_channel->get_io_service().post(std::bind(m_handle, ec));
+        }
+    }
+
+    void
+    cork(bool enable) {
+        if(!m_batching.cork || m_corked == enable) {
             return;
         }
 
-        m_channel->async_write_some(
-            m_messages,
-            std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
-        );
+        m_corked = enable;
+
+        std::error_code ec;
+
+        // Errors are ignored, since corking is merely an optimization.
+        m_channel->set_option(aux::cork_t(enable), ec);
     }
 };
 
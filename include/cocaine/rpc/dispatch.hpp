@@ -26,14 +26,20 @@
 
 #include "cocaine/rpc/slot/blocking.hpp"
 #include "cocaine/rpc/slot/deferred.hpp"
+#include "cocaine/rpc/slot/offloaded.hpp"
 #include "cocaine/rpc/slot/streamed.hpp"
 
 #include "cocaine/rpc/traversal.hpp"
 
 #include "cocaine/traits/tuple.hpp"
 
-#include <boost/mpl/transform.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+
 #include <boost/mpl/lambda.hpp>
+#include <boost/mpl/size.hpp>
+#include <boost/mpl/transform.hpp>
 
 #include <boost/variant/apply_visitor.hpp>
 #include <boost/variant/static_visitor.hpp>
@@ -87,6 +93,26 @@ public:
     version() const = 0;
 };
 
+// Hazard slots, which protect the retired slot tables from being reclaimed while some thread is still
+// looking them up. Every thread owns a single slot, acquired on its first lookup, so that lookups only
+// write to their own cache lines. Slots of the exited threads are reused by the new ones.
+
+struct hazard_t {
+    std::atomic<const void*> pointer;
+    std::atomic<bool> acquired;
+    hazard_t* next;
+
+    // The slot of the calling thread.
+    static
+    hazard_t&
+    local();
+
+    // Whether some thread is looking up the given pointer right now.
+    static
+    bool
+    protects(const void* pointer);
+};
+
 } // namespace io
 
 namespace mpl = boost::mpl;
@@ -106,12 +132,21 @@ class dispatch:
         >::type
     >::type slot_types;
 
-    typedef std::map<
-        int,
-        typename boost::make_variant_over<slot_types>::type
-    > slot_map_t;
+    typedef typename boost::make_variant_over<slot_types>::type slot_variant_t;
+
+    // Protocol message ids are dense, so slots are stored in a fixed table indexed by message id.
+    typedef std::array<
+        boost::optional<slot_variant_t>,
+        mpl::size<slot_types>::value
+    > slot_table_t;
+
+    // The current slot table. Lookups are a single atomic load guarded by the thread's hazard slot,
+    // while modifications copy the table and publish the new one. Previous tables are retired, and
+    // reclaimed by the next modification once no thread is looking them up.
+    std::atomic<const slot_table_t*> m_slots;
 
-    synchronized<slot_map_t> m_slots;
+    // The current slot table is the last, the others are retired. Also serializes modifications.
+    synchronized<std::vector<std::unique_ptr<slot_table_t>>> m_tables;
 
     // Slot traits
 
@@ -129,12 +164,20 @@ public:
     explicit
     dispatch(const std::string& name):
         basic_dispatch_t(name)
-    { }
+    {
+        m_tables.unsafe().emplace_back(new slot_table_t());
+        m_slots.store(m_tables.unsafe().back().get());
+    }
 
     template<class Event, class F>
     dispatch&
     on(const F& callable, typename boost::disable_if<is_slot<F, Event>>::type* = nullptr);
 
+    // Binds a blocking callable, which is invoked on the executor instead of the I/O thread.
+    template<class Event, class F>
+    dispatch&
+    on(const F& callable, const std::shared_ptr<io::executor_t>& executor);
+
     template<class Event>
     dispatch&
     on(const std::shared_ptr<io::basic_slot<Event>>& ptr);
@@ -165,6 +208,11 @@ public:
     template<class Visitor>
     typename Visitor::result_type
     process(int id, const Visitor& visitor) const;
+
+private:
+    template<class F>
+    void
+    publish(const F& modify);
 };
 
 template<class Tag>
@@ -239,15 +287,31 @@ dispatch<Tag>::on(const F& callable, typename boost::disable_if<is_slot<F, Event
     return on<Event>(std::make_shared<slot_type>(callable));
 }
 
+template<class Tag>
+template<class Event, class F>
+dispatch<Tag>&
+dispatch<Tag>::on(const F& callable, const std::shared_ptr<io::executor_t>& executor) {
+    typedef io::offloaded_slot<
+        Event,
+        typename result_of<F>::type
+    > slot_type;
+
+    return on<Event>(std::make_shared<slot_type>(callable, executor));
+}
+
 template<class Tag>
 template<class Event>
 dispatch<Tag>&
 dispatch<Tag>::on(const std::shared_ptr<io::basic_slot<Event>>& ptr) {
     typedef io::event_traits<Event> traits;
 
-    if(!m_slots->insert(std::make_pair(traits::id, ptr)).second) {
-        throw cocaine::error_t("duplicate type %d slot: %s", traits::id, Event::alias());
-    }
+    publish([&](slot_table_t& table) {
+        if(table[traits::id]) {
+            throw cocaine::error_t("duplicate type %d slot: %s", traits::id, Event::alias());
+        }
+
+        table[traits::id] = slot_variant_t(ptr);
+    });
 
     return *this;
 }
@@ -256,9 +320,38 @@ template<class Tag>
 template<class Event>
 void
 dispatch<Tag>::forget() {
-    if(!m_slots->erase(io::event_traits<Event>::id)) {
-        throw cocaine::error_t("type %d slot does not exist", io::event_traits<Event>::id);
-    }
+    typedef io::event_traits<Event> traits;
+
+    publish([&](slot_table_t& table) {
+        if(!table[traits::id]) {
+            throw cocaine::error_t("type %d slot does not exist", traits::id);
+        }
+
+        table[traits::id] = boost::none;
+    });
+}
+
+template<class Tag>
+template<class F>
+void
+dispatch<Tag>::publish(const F& modify) {
+    m_tables.apply([&](std::vector<std::unique_ptr<slot_table_t>>& tables) {
+        std::unique_ptr<slot_table_t> table(new slot_table_t(*tables.back()));
+
+        // Nothing is published if the modification fails.
+        modify(*table);
+
+        tables.push_back(std::move(table));
+        m_slots.store(tables.back().get());
+
+        // NOTE: Lookups which announce a retired table after this point see that it's not current
+        // anymore and retry, so the tables which aren't protected right now are safe to reclaim.
+        tables.erase(std::remove_if(tables.begin(), tables.end() - 1,
+            [](const std::unique_ptr<slot_table_t>& retired) {
+                return !io::hazard_t::protects(retired.get());
+            }
+        ), tables.end() - 1);
+    });
 }
 
 template<class Tag>
@@ -271,25 +364,39 @@ template<class Tag>
 template<class Visitor>
 typename Visitor::result_type
 dispatch<Tag>::process(int id, const Visitor& visitor) const {
-    typedef typename slot_map_t::mapped_type slot_ptr_type;
+    boost::optional<slot_variant_t> slot;
+
+    io::hazard_t& hazard = io::hazard_t::local();
 
-    const auto slot = m_slots.apply([&](const slot_map_t& mapping) -> slot_ptr_type {
-        typename slot_map_t::const_iterator lb, ub;
+    const slot_table_t* table = m_slots.load();
 
-        // NOTE: Using equal_range() here, instead of find() to check for slot existence and get the
-        // slot pointer in one call instead of two.
-        std::tie(lb, ub) = mapping.equal_range(id);
+    // Announce the table, and make sure that it hasn't been retired meanwhile.
+    while(true) {
+        hazard.pointer.store(table);
 
-        if(lb != ub) {
-            // NOTE: The slot pointer is copied here, allowing the handling code to unregister slots
-            // via dispatch<T>::forget() without pulling the object from underneath itself.
-            return lb->second;
-        } else {
-            throw cocaine::error_t("type %d slot wasn't bound to this dispatch", id);
+        const slot_table_t* current = m_slots.load();
+
+        if(current == table) {
+            break;
         }
-    });
 
-    return boost::apply_visitor(visitor, slot);
+        table = current;
+    }
+
+    // NOTE: The slot pointer is copied here, allowing the handling code to unregister slots via
+    // dispatch<T>::forget() without pulling the object from underneath itself. The table itself
+    // might be reclaimed as soon as the lookup is over.
+    if(id >= 0 && static_cast<size_t>(id) < table->size()) {
+        slot = (*table)[id];
+    }
+
+    hazard.pointer.store(nullptr, std::memory_order_release);
+
+    if(!slot) {
+        throw cocaine::error_t("type %d slot wasn't bound to this dispatch", id);
+    }
+
+    return boost::apply_visitor(visitor, *slot);
 }
 
 } // namespace cocaine
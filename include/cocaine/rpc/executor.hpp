@@ -0,0 +1,77 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_EXECUTOR_HPP
+#define COCAINE_IO_EXECUTOR_HPP
+
+#include "cocaine/common.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#define BOOST_BIND_NO_PLACEHOLDERS
+#include <boost/thread/thread.hpp>
+
+namespace cocaine { namespace io {
+
+// Bounded pool of worker threads for blocking slots, so that slow callables, like synchronous disk
+// I/O, wouldn't stall the execution units. Tasks are rejected once the queue limit is reached.
+
+class executor_t {
+    COCAINE_DECLARE_NONCOPYABLE(executor_t)
+
+    typedef std::function<void()> task_type;
+
+    const std::unique_ptr<logging::log_t> m_log;
+
+    const size_t m_limit;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    std::deque<task_type> m_queue;
+
+    // Whether the executor is being destroyed. Workers finish the queued tasks and exit.
+    bool m_stopped;
+
+    boost::thread_group m_threads;
+
+public:
+    executor_t(std::unique_ptr<logging::log_t> log, const std::string& name, size_t threads, size_t limit);
+   ~executor_t();
+
+    // Thread-safe. Returns false if the queue is full, in which case the task is dropped.
+    bool
+    post(task_type task);
+
+    // Number of queued tasks, not including the ones being run. Thread-safe.
+    size_t
+    size() const;
+
+private:
+    void
+    run(const std::string& name);
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -24,8 +24,12 @@
 #include "cocaine/common.hpp"
 #include "cocaine/locked_ptr.hpp"
 
+#include "cocaine/rpc/asio/backlog.hpp"
 #include "cocaine/rpc/asio/encoder.hpp"
 #include "cocaine/rpc/asio/decoder.hpp"
+#include "cocaine/rpc/asio/message_pool.hpp"
+
+#include <atomic>
 
 #include <asio/ip/tcp.hpp>
 
@@ -34,28 +38,51 @@ namespace cocaine {
 class session_t:
     public std::enable_shared_from_this<session_t>
 {
+public:
+    class backpressure_t;
+
+    // Owner of the session, which is notified on the execution unit thread once the session has been
+    // detached, so that it could drop its reference right away.
+    struct detach_hook_t {
+        virtual
+       ~detach_hook_t() {
+            // Empty.
+        }
+
+        virtual
+        void
+        detached(session_t& session, int key) = 0;
+    };
+
+private:
     class pull_action_t;
-    class push_action_t;
+    class write_handler_t;
 
-    class channel_t;
+    // Protocol-agnostic interface to the underlying channel, see session.cpp.
+    class transport_t;
+
+    template<class Protocol>
+    class basic_transport_t;
 
-    typedef std::map<uint64_t, std::shared_ptr<channel_t>> channel_map_t;
+    class channel_t;
+    class channel_table_t;
 
     // Log of last resort.
     const std::unique_ptr<logging::log_t> log;
 
-    // The underlying connection.
+    // The underlying connection, either a TCP or a local one.
 #if defined(__clang__)
-    std::shared_ptr<io::channel<asio::ip::tcp>> transport;
+    std::shared_ptr<transport_t> transport;
 #else
-    synchronized<std::shared_ptr<io::channel<asio::ip::tcp>>> transport;
+    synchronized<std::shared_ptr<transport_t>> transport;
 #endif
 
     // Initial dispatch. Internally synchronized.
     const io::dispatch_ptr_t prototype;
 
-    // Virtual channels.
-    synchronized<channel_map_t> channels;
+    // Virtual channels. Lookups are lock-free on the execution unit thread, while modifications are
+    // synchronized and might happen on any thread.
+    const std::unique_ptr<synchronized<channel_table_t>> channels;
 
     // The maximum channel id processed by the session. Checking whether channel id is always higher
     // than the previous channel id is similar to an infinite TIME_WAIT timeout for TCP sockets. It
@@ -63,21 +90,74 @@ class session_t:
     // ports available to us, it's good enough.
     uint64_t max_channel_id;
 
+    // Outgoing messages pool, shared with other sessions of the same execution unit.
+    const std::shared_ptr<io::message_pool_t> pool;
+
+    // Outgoing messages which are yet to be handed over to the writer. Producers from any thread push
+    // messages here, and the execution unit drains them in batches.
+    io::outbound_queue_t outbox;
+
+    // Intrusive queue of outgoing messages which are being written, and whether the completion handler
+    // has been bound to the writer yet. Only accessed on the execution unit thread.
+    struct {
+        io::pooled_message_t* head;
+        io::pooled_message_t* tail;
+        bool bound;
+    } pending;
+
+    // Outgoing data backlog of this session, and the backpressure state shared with other sessions of
+    // the same execution unit.
+    io::backlog_t backlog;
+    const std::shared_ptr<backpressure_t> backpressure;
+
+    // Whether the session has been already scheduled to be closed because of its overflown backlog.
+    std::atomic<bool> overflown;
+
+    // Read operation paused until the outgoing backlogs drain. Only accessed on the execution unit
+    // thread.
+    std::shared_ptr<pull_action_t> paused;
+
+    // Owner hook and the key the session is registered with there. Only accessed on the execution
+    // unit thread.
+    struct {
+        detach_hook_t* hook;
+        int key;
+    } owner;
+
 public:
+    // Instantiated for TCP and local stream protocols only.
+    template<class Protocol>
     session_t(std::unique_ptr<logging::log_t> log,
-              std::unique_ptr<io::channel<asio::ip::tcp>> transport, const io::dispatch_ptr_t& prototype);
+              std::unique_ptr<io::channel<Protocol>> transport, const io::dispatch_ptr_t& prototype,
+              const std::shared_ptr<io::message_pool_t>& pool,
+              const std::shared_ptr<backpressure_t>& backpressure);
+
+   ~session_t();
 
     // Observers
 
     auto
     active_channels() const -> std::map<uint64_t, std::string>;
 
+    // Whether the outgoing backlog of either this session or its execution unit is over the high
+    // watermark. Reading from a congested session is paused, so that clients couldn't make it send
+    // even more, while other producers should check it via their upstreams and hold off till it
+    // drains below the low watermark. Messages are never refused, but a session whose own backlog
+    // overflows is closed.
+    bool
+    congested() const;
+
+    // Whether the session is still attached to its transport.
+    bool
+    connected() const;
+
     size_t
     memory_pressure() const;
 
     auto
     name() const -> std::string;
 
+    // Unspecified for local connections.
     auto
     remote_endpoint() const -> asio::ip::tcp::endpoint;
 
@@ -86,12 +166,23 @@ public:
     auto
     fork(const io::dispatch_ptr_t& dispatch) -> io::upstream_ptr_t;
 
+    // Must be called on the execution unit thread, before the session is started.
+    void
+    bind(detach_hook_t* hook, int key);
+
     void
     pull();
 
+    template<class Event, class... Args>
+    void
+    send(uint64_t channel_id, Args&&... args);
+
     void
     push(io::encoder_t::message_type&& message);
 
+    void
+    push(std::unique_ptr<io::pooled_message_t> message);
+
     // NOTE: Detaching a session destroys the connection but not necessarily the session itself, as
     // it might be still in use by shared upstreams even in other threads. In other words, this does
     // not guarantee that the session will be actually deleted, but it's fine, since the connection
@@ -111,8 +202,89 @@ private:
 
     void
     revoke(uint64_t channel_id);
+
+    // Frees the channels removed since the last call. Must be called on the execution unit thread,
+    // where no channel lookup is in progress.
+
+    void
+    reclaim();
+
+    void
+    do_drain(const std::shared_ptr<transport_t>& ptr);
+
+    void
+    do_push(io::pooled_message_t* message, const std::shared_ptr<transport_t>& ptr);
+
+    void
+    on_write(const std::error_code& ec);
+
+    void
+    pause(const std::shared_ptr<pull_action_t>& action);
+
+    void
+    resume();
 };
 
+// Backpressure watermarks and the outgoing data backlog shared by all the sessions of an execution
+// unit. Sessions which have paused reading because of the shared backlog are resumed once it drains.
+
+class session_t::backpressure_t:
+    public std::enable_shared_from_this<backpressure_t>
+{
+    COCAINE_DECLARE_NONCOPYABLE(backpressure_t)
+
+    const std::shared_ptr<asio::io_service> m_asio;
+
+    io::backlog_t m_backlog;
+
+    // Sessions waiting for the shared backlog to drain. Only accessed on the execution unit thread.
+    std::vector<std::weak_ptr<session_t>> m_waiters;
+
+public:
+    // Watermarks for every individual session.
+    const size_t high;
+    const size_t low;
+
+    backpressure_t(const std::shared_ptr<asio::io_service>& asio, size_t high, size_t low,
+                   size_t shared_high, size_t shared_low);
+
+    bool
+    congested() const {
+        return m_backlog.congested();
+    }
+
+    size_t
+    size() const {
+        return m_backlog.size();
+    }
+
+    void
+    acquire(size_t bytes) {
+        m_backlog.acquire(bytes);
+    }
+
+    void
+    release(size_t bytes);
+
+    void
+    wait(const std::shared_ptr<session_t>& session);
+
+private:
+    void
+    notify();
+};
+
+template<class Event, class... Args>
+void
+session_t::send(uint64_t channel_id, Args&&... args) {
+    auto message = pool->acquire();
+
+    // Encode the message right into a pooled buffer.
+    io::encoded<Event>::encode(message->message, channel_id, std::forward<Args>(args)...);
+
+    push(std::move(message));
+}
+
 } // namespace cocaine
 
 #endif
@@ -0,0 +1,159 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_OFFLOADED_SLOT_HPP
+#define COCAINE_IO_OFFLOADED_SLOT_HPP
+
+#include "cocaine/rpc/executor.hpp"
+
+#include "cocaine/rpc/slot/blocking.hpp"
+
+#include "cocaine/traits/view.hpp"
+
+namespace cocaine { namespace io {
+
+namespace aux {
+
+// Borrowed arguments would dangle once the frame is gone, so offloaded invocations own a copy of them.
+// Views over arrays are not supported, since they reference the frame's object tree.
+
+template<class T>
+struct owning_argument {
+    typedef T type;
+};
+
+template<>
+struct owning_argument<string_view_t> {
+    typedef std::string type;
+};
+
+template<class T>
+struct owning_argument<array_view_t<T>>;
+
+template<class Tuple>
+struct owning_tuple;
+
+template<class... Args>
+struct owning_tuple<std::tuple<Args...>> {
+    typedef std::tuple<typename owning_argument<Args>::type...> type;
+};
+
+template<class IndexSequence>
+struct own_impl;
+
+template<size_t... Indices>
+struct own_impl<index_sequence<Indices...>> {
+    template<class... Args>
+    static inline
+    typename owning_tuple<std::tuple<Args...>>::type
+    apply(std::tuple<Args...>&& args) {
+        return typename owning_tuple<std::tuple<Args...>>::type(
+            own(std::move(std::get<Indices>(args)))...
+        );
+    }
+
+private:
+    template<class T>
+    static inline
+    T&&
+    own(T&& value) {
+        return std::move(value);
+    }
+
+    static inline
+    std::string
+    own(string_view_t&& value) {
+        return value.str();
+    }
+};
+
+} // namespace aux
+
+// Runs a blocking slot on the executor instead of the I/O thread. The result is delivered through
+// the upstream from the executor thread. If the executor queue is full, the invocation fails right
+// away with error::resource_error.
+
+template<
+    class Event,
+    class R = typename result_of<Event>::type
+>
+struct offloaded_slot:
+    public basic_slot<Event>
+{
+    typedef blocking_slot<Event, R> slot_type;
+
+    typedef typename slot_type::callable_type callable_type;
+    typedef typename slot_type::dispatch_type dispatch_type;
+    typedef typename slot_type::tuple_type    tuple_type;
+    typedef typename slot_type::upstream_type upstream_type;
+    typedef typename slot_type::protocol      protocol;
+
+    typedef typename aux::owning_tuple<tuple_type>::type owning_type;
+
+    offloaded_slot(callable_type callable, const std::shared_ptr<executor_t>& executor_):
+        slot(std::make_shared<slot_type>(callable)),
+        executor(executor_)
+    { }
+
+    virtual
+    boost::optional<std::shared_ptr<const dispatch_type>>
+    operator()(tuple_type&& args, upstream_type&& upstream) {
+        typedef aux::own_impl<
+            typename make_index_sequence<std::tuple_size<tuple_type>::value>::type
+        > own_type;
+
+        const bool posted = executor->post(std::bind(&offloaded_slot::invoke,
+            slot,
+            own_type::apply(std::move(args)),
+            upstream
+        ));
+
+        if(!posted) {
+            try {
+                upstream.template send<typename protocol::error>(error::resource_error,
+                    std::string("blocking slot queue is full"));
+            } catch(const std::system_error&) {
+                // The client is not able to receive anything anyway.
+            }
+        }
+
+        if(is_recursed<Event>::value) {
+            return boost::none;
+        } else {
+            return boost::make_optional<std::shared_ptr<const dispatch_type>>(nullptr);
+        }
+    }
+
+private:
+    static
+    void
+    invoke(const std::shared_ptr<slot_type>& slot, owning_type& args, upstream_type& upstream) {
+        // Borrowed arguments reference the owning copies, which live as long as this task does.
+        (*slot)(tuple_type(std::move(args)), std::move(upstream));
+    }
+
+private:
+    const std::shared_ptr<slot_type> slot;
+    const std::shared_ptr<executor_t> executor;
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -85,6 +85,14 @@ struct unwrap_type<optional_with_default<T, Default>> {
     typedef T type;
 };
 
+// Borrowed view types, which are unpacked right from the decoded frame, are packed from the owning
+// types they refer to.
+
+template<class T>
+struct owning_type {
+    typedef T type;
+};
+
 // Protocol compatibility
 
 template<class T, class U>
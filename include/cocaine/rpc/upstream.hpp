@@ -39,6 +39,12 @@ public:
         channel_id(channel_id_)
     { }
 
+    // Producers should hold off sending while the session is congested, see session_t::congested().
+    bool
+    congested() const {
+        return session->congested();
+    }
+
     template<class Event, class... Args>
     void
     send(Args&&... args);
@@ -47,7 +53,7 @@ public:
 template<class Event, class... Args>
 void
 basic_upstream_t::send(Args&&... args) {
-    session->push(encoded<Event>(channel_id, std::forward<Args>(args)...));
+    session->send<Event>(channel_id, std::forward<Args>(args)...);
 }
 
 // Forwards for the upstream<T> class
@@ -87,6 +93,11 @@ public:
         // Move the actual upstream pointer down the graph.
         return std::move(ptr);
     }
+
+    bool
+    congested() const {
+        return ptr->congested();
+    }
 };
 
 template<>
@@ -153,6 +153,15 @@ private:
 
 } // namespace aux
 
+// Argument sequence which has already been packed elsewhere, for example a sequence cut out of a
+// frame received from another peer. It's spliced into the outgoing message verbatim, so it's up to
+// the caller to make sure that it matches the sequence type.
+
+struct raw_sequence_t {
+    const char * blob;
+    const size_t size;
+};
+
 // Variadic pack serialization
 
 template<class T>
@@ -195,6 +204,13 @@ public:
         traits_type::template pack<T>(target, source);
     }
 
+    template<class Stream>
+    static inline
+    void
+    pack(msgpack::packer<Stream>& target, const raw_sequence_t& source) {
+        target.pack_raw_body(source.blob, source.size);
+    }
+
     template<class... Args>
     static inline
     void
@@ -253,9 +269,11 @@ private:
     pack_sequence(msgpack::packer<Stream>& target, const Head& head, const Tail&... tail) {
         typedef typename pristine<Head>::type type;
         typedef typename boost::mpl::deref<It>::type element_type;
+        typedef typename details::unwrap_type<element_type>::type unwrapped_type;
 
         static_assert(
-            std::is_convertible<type, typename details::unwrap_type<element_type>::type>::value,
+            std::is_convertible<type, unwrapped_type>::value ||
+            std::is_convertible<type, typename details::owning_type<unwrapped_type>::type>::value,
             "sequence element type mismatch"
         );
 
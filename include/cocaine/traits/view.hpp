@@ -0,0 +1,202 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_VIEW_SERIALIZATION_TRAITS_HPP
+#define COCAINE_VIEW_SERIALIZATION_TRAITS_HPP
+
+#include "cocaine/traits.hpp"
+
+#include "cocaine/rpc/tags.hpp"
+
+#include "cocaine/view.hpp"
+
+#include <iterator>
+#include <vector>
+
+namespace cocaine { namespace io {
+
+// Non-owning view over a MessagePack array, e.g. right inside a decoded message frame. Elements are
+// unpacked lazily on access, so views over arrays of string views never copy anything. The same as
+// string views, it must never be retained.
+
+template<class T>
+class array_view_t {
+    const msgpack::object* m_data;
+    size_t                 m_size;
+
+public:
+    class const_iterator:
+        public std::iterator<std::forward_iterator_tag, T, std::ptrdiff_t, const T*, T>
+    {
+        const msgpack::object* m_it;
+
+    public:
+        explicit
+        const_iterator(const msgpack::object* it):
+            m_it(it)
+        { }
+
+        T
+        operator*() const;
+
+        const_iterator&
+        operator++() {
+            ++m_it;
+            return *this;
+        }
+
+        const_iterator
+        operator++(int) {
+            const_iterator result(*this);
+            ++m_it;
+            return result;
+        }
+
+        bool
+        operator==(const const_iterator& other) const {
+            return m_it == other.m_it;
+        }
+
+        bool
+        operator!=(const const_iterator& other) const {
+            return m_it != other.m_it;
+        }
+    };
+
+    array_view_t():
+        m_data(nullptr),
+        m_size(0)
+    { }
+
+    array_view_t(const msgpack::object* data, size_t size):
+        m_data(data),
+        m_size(size)
+    { }
+
+    // Observers
+
+    const msgpack::object*
+    data() const {
+        return m_data;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+
+    bool
+    empty() const {
+        return m_size == 0;
+    }
+
+    const_iterator
+    begin() const {
+        return const_iterator(m_data);
+    }
+
+    const_iterator
+    end() const {
+        return const_iterator(m_data + m_size);
+    }
+
+    T
+    operator[](size_t index) const {
+        return *const_iterator(m_data + index);
+    }
+};
+
+template<>
+struct type_traits<string_view_t> {
+    template<class Stream>
+    static inline
+    void
+    pack(msgpack::packer<Stream>& target, const string_view_t& source) {
+        target.pack_raw(source.size());
+        target.pack_raw_body(source.data(), source.size());
+    }
+
+    static inline
+    void
+    unpack(const msgpack::object& source, string_view_t& target) {
+        if(source.type != msgpack::type::RAW) {
+            throw msgpack::type_error();
+        }
+
+        target = string_view_t(source.via.raw.ptr, source.via.raw.size);
+    }
+};
+
+template<class T>
+struct type_traits<array_view_t<T>> {
+    template<class Stream>
+    static inline
+    void
+    pack(msgpack::packer<Stream>& target, const array_view_t<T>& source) {
+        target.pack_array(source.size());
+
+        for(size_t i = 0; i < source.size(); ++i) {
+            target << source.data()[i];
+        }
+    }
+
+    static inline
+    void
+    unpack(const msgpack::object& source, array_view_t<T>& target) {
+        if(source.type != msgpack::type::ARRAY) {
+            throw msgpack::type_error();
+        }
+
+        // Validate the elements right away, so that type mismatches are reported before the slot
+        // is invoked, same as for owning types.
+        for(size_t i = 0; i < source.via.array.size; ++i) {
+            T element;
+            type_traits<T>::unpack(source.via.array.ptr[i], element);
+        }
+
+        target = array_view_t<T>(source.via.array.ptr, source.via.array.size);
+    }
+};
+
+template<class T>
+T
+array_view_t<T>::const_iterator::operator*() const {
+    T result;
+    type_traits<T>::unpack(*m_it, result);
+    return result;
+}
+
+namespace details {
+
+template<>
+struct owning_type<string_view_t> {
+    typedef std::string type;
+};
+
+template<class T>
+struct owning_type<array_view_t<T>> {
+    typedef std::vector<typename owning_type<T>::type> type;
+};
+
+} // namespace details
+
+}} // namespace cocaine::io
+
+#endif
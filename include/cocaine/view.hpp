@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_VIEW_HPP
+#define COCAINE_VIEW_HPP
+
+#include <cstring>
+#include <string>
+
+namespace cocaine {
+
+// Non-owning reference to a contiguous sequence of characters, e.g. right inside a decoded message
+// frame. It's only valid as long as the referenced memory is, so it must never be retained. Slots
+// might declare view arguments to avoid copying the payload out of the frame, in which case the
+// views are valid for the duration of the slot call.
+
+class string_view_t {
+    const char* m_data;
+    size_t      m_size;
+
+public:
+    typedef const char* const_iterator;
+
+    string_view_t():
+        m_data(nullptr),
+        m_size(0)
+    { }
+
+    string_view_t(const char* data, size_t size):
+        m_data(data),
+        m_size(size)
+    { }
+
+    string_view_t(const std::string& source):
+        m_data(source.data()),
+        m_size(source.size())
+    { }
+
+    // Observers
+
+    const char*
+    data() const {
+        return m_data;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+
+    bool
+    empty() const {
+        return m_size == 0;
+    }
+
+    const_iterator
+    begin() const {
+        return m_data;
+    }
+
+    const_iterator
+    end() const {
+        return m_data + m_size;
+    }
+
+    // Makes an owning copy.
+    std::string
+    str() const {
+        return std::string(m_data, m_size);
+    }
+
+    bool
+    operator==(const string_view_t& other) const {
+        return m_size == other.m_size && (m_size == 0 || std::memcmp(m_data, other.m_data, m_size) == 0);
+    }
+
+    bool
+    operator!=(const string_view_t& other) const {
+        return !(*this == other);
+    }
+};
+
+// Opaque binary payloads are represented exactly as strings on the wire.
+typedef string_view_t bytes_view_t;
+
+} // namespace cocaine
+
+#endif
@@ -30,6 +30,8 @@
 
 #include "cocaine/rpc/dispatch.hpp"
 
+#include <unistd.h>
+
 using namespace asio;
 using namespace asio::ip;
 
@@ -107,6 +109,180 @@ actor_t::accept_action_t::finalize(const std::error_code& ec) {
     operator()();
 }
 
+// Local acceptor. Local connections are handed off to execution units just like TCP ones.
+
+class actor_t::local_accept_action_t:
+    public std::enable_shared_from_this<local_accept_action_t>
+{
+    actor_t *const parent;
+    local::stream_protocol::socket socket;
+
+public:
+    local_accept_action_t(actor_t *const parent_):
+        parent(parent_),
+        socket(*parent->m_asio)
+    { }
+
+    void
+    operator()();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+void
+actor_t::local_accept_action_t::operator()() {
+    parent->m_acceptor.apply([this](std::unique_ptr<tcp::acceptor>&) {
+        if(!parent->m_local) {
+            COCAINE_LOG_ERROR(parent->m_log, "abnormal termination of actor local connection pump");
+            return;
+        }
+
+        using namespace std::placeholders;
+
+        parent->m_local->async_accept(socket, std::bind(&local_accept_action_t::finalize,
+            shared_from_this(),
+            _1
+        ));
+    });
+}
+
+void
+actor_t::local_accept_action_t::finalize(const std::error_code& ec) {
+    auto ptr = std::make_shared<local::stream_protocol::socket>(std::move(socket));
+
+    switch(ec.value()) {
+    case 0:
+        COCAINE_LOG_DEBUG(parent->m_log, "accepted local connection on fd %d", ptr->native_handle());
+
+        try {
+            parent->m_context.engine().attach(ptr, parent->m_prototype);
+        } catch(const std::system_error& e) {
+            COCAINE_LOG_ERROR(parent->m_log, "unable to attach local connection to engine: [%d] %s - %s",
+                e.code().value(), e.code().message(), e.what());
+        }
+
+        break;
+
+    case asio::error::operation_aborted:
+        return;
+
+    default:
+        COCAINE_LOG_ERROR(parent->m_log, "unable to accept local connection: [%d] %s", ec.value(),
+            ec.message());
+        break;
+    }
+
+    operator()();
+}
+
+// Sharded acceptor, which accepts connections right on the reactor of the execution unit which is
+// going to serve them. It doesn't reference the actor, as it might outlive it for a moment.
+
+class actor_t::sharded_accept_action_t:
+    public std::enable_shared_from_this<sharded_accept_action_t>
+{
+    const std::unique_ptr<logging::log_t> log;
+
+    execution_unit_t& engine;
+    const io::dispatch_ptr_t prototype;
+
+    tcp::acceptor acceptor;
+    std::unique_ptr<tcp::socket> socket;
+
+public:
+    sharded_accept_action_t(context_t& context, execution_unit_t& engine,
+                            const io::dispatch_ptr_t& prototype, const tcp::endpoint& endpoint);
+
+    void
+    operator()();
+
+    // Schedules the first accept on the execution unit reactor. Thread-safe.
+    void
+    start();
+
+    // Closes the acceptor on the execution unit reactor. Thread-safe.
+    void
+    cancel();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+actor_t::sharded_accept_action_t::sharded_accept_action_t(context_t& context, execution_unit_t& engine_,
+                                                          const io::dispatch_ptr_t& prototype_,
+                                                          const tcp::endpoint& endpoint)
+:
+    log(context.log("core:asio", {
+        attribute::make("service", prototype_->name())
+    })),
+    engine(engine_),
+    prototype(prototype_),
+    acceptor(engine_.get_io_service())
+{
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    acceptor.set_option(reuse_port_t(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+}
+
+void
+actor_t::sharded_accept_action_t::operator()() {
+    using namespace std::placeholders;
+
+    socket = std::make_unique<tcp::socket>(engine.get_io_service());
+
+    acceptor.async_accept(*socket, std::bind(&sharded_accept_action_t::finalize, shared_from_this(), _1));
+}
+
+void
+actor_t::sharded_accept_action_t::start() {
+    engine.get_io_service().post(std::bind(&sharded_accept_action_t::operator(), shared_from_this()));
+}
+
+void
+actor_t::sharded_accept_action_t::cancel() {
+    auto self = shared_from_this();
+
+    engine.get_io_service().post([self] {
+        std::error_code ec;
+
+        // Pending accept operation will be aborted.
+        self->acceptor.close(ec);
+    });
+}
+
+void
+actor_t::sharded_accept_action_t::finalize(const std::error_code& ec) {
+    switch(ec.value()) {
+    case 0:
+        COCAINE_LOG_DEBUG(log, "accepted connection on fd %d", socket->native_handle());
+
+        try {
+            // The connection is already on the right reactor, so there's no need to clone it.
+            engine.attach(std::move(socket), prototype);
+        } catch(const std::system_error& e) {
+            COCAINE_LOG_ERROR(log, "unable to attach connection to engine: [%d] %s - %s",
+                e.code().value(), e.code().message(), e.what());
+        }
+
+        break;
+
+    case asio::error::operation_aborted:
+        return;
+
+    default:
+        COCAINE_LOG_ERROR(log, "unable to accept connection: [%d] %s", ec.value(),
+            ec.message());
+        break;
+    }
+
+    operator()();
+}
+
 // Actor
 
 actor_t::actor_t(context_t& context, const std::shared_ptr<io_service>& asio,
@@ -191,6 +367,23 @@ actor_t::is_active() const {
     return static_cast<bool>(*m_acceptor.synchronize());
 }
 
+std::string
+actor_t::local_endpoint() const {
+    return m_acceptor.apply([this](const std::unique_ptr<tcp::acceptor>&) -> std::string {
+        std::error_code ec;
+
+        if(m_local) {
+            const auto endpoint = m_local->local_endpoint(ec);
+
+            if(!ec) {
+                return endpoint.path();
+            }
+        }
+
+        return std::string();
+    });
+}
+
 const io::basic_dispatch_t&
 actor_t::prototype() const {
     return *m_prototype;
@@ -198,28 +391,96 @@ actor_t::prototype() const {
 
 void
 actor_t::run() {
-    m_acceptor.apply([this](std::unique_ptr<tcp::acceptor>& ptr) {
+    const bool sharded = m_context.config.network.reuseport;
+
+    m_acceptor.apply([&](std::unique_ptr<tcp::acceptor>& ptr) {
+        const tcp::endpoint endpoint = {
+            m_context.config.network.endpoint,
+            m_context.mapper.assign(m_prototype->name())
+        };
+
         try {
-            ptr = std::make_unique<tcp::acceptor>(*m_asio, tcp::endpoint {
-                m_context.config.network.endpoint,
-                m_context.mapper.assign(m_prototype->name())
-            });
+            if(!sharded) {
+                ptr = std::make_unique<tcp::acceptor>(*m_asio, endpoint);
+            } else {
+                ptr = std::make_unique<tcp::acceptor>(*m_asio);
+
+                ptr->open(endpoint.protocol());
+                ptr->set_option(tcp::acceptor::reuse_address(true));
+                ptr->set_option(reuse_port_t(true));
+
+                // NOTE: This acceptor only holds the endpoint and doesn't listen on it, so that all the
+                // incoming connections would go to the sharded acceptors.
+                ptr->bind(endpoint);
+
+                const auto& engines = m_context.engines();
+
+                for(auto it = engines.begin(); it != engines.end(); ++it) {
+                    m_shards.push_back(std::make_shared<sharded_accept_action_t>(
+                        m_context, **it, m_prototype, ptr->local_endpoint()
+                    ));
+                }
+            }
+
+            if(m_context.config.network.local) {
+                const local::stream_protocol::endpoint path(
+                    m_context.config.path.runtime + "/" + m_prototype->name() + ".sock"
+                );
+
+                std::error_code ec;
+
+                // The socket file might have been left behind by a previous instance, but it also might
+                // belong to a live one, in which case it must be left intact.
+                local::stream_protocol::socket(*m_asio).connect(path, ec);
+
+                if(!ec) {
+                    throw std::system_error(asio::error::address_in_use);
+                } else if(ec == asio::error::connection_refused) {
+                    ::unlink(path.path().c_str());
+                }
+
+                m_local = std::make_unique<local::stream_protocol::acceptor>(*m_asio, path);
+            }
         } catch(const std::system_error& e) {
             COCAINE_LOG_ERROR(m_log, "unable to bind local endpoint for service: [%d] %s",
                 e.code().value(),
                 e.code().message());
+
+            m_shards.clear();
+            m_local = nullptr;
+            ptr     = nullptr;
+
             throw;
         }
 
         std::error_code ec;
-        const auto endpoint = ptr->local_endpoint(ec);
+        const auto local = ptr->local_endpoint(ec);
 
-        COCAINE_LOG_INFO(m_log, "exposing service on local endpoint %s", endpoint);
-    });
+        COCAINE_LOG_INFO(m_log, "exposing service on local endpoint %s%s", local,
+            sharded ? ", sharded" : "");
 
-    m_asio->post(std::bind(&accept_action_t::operator(),
-        std::make_shared<accept_action_t>(this)
-    ));
+        if(m_local) {
+            COCAINE_LOG_INFO(m_log, "exposing service on local socket %s", m_local->local_endpoint(ec));
+        }
+
+        // NOTE: Started under the lock, so that a concurrent terminate() would either see no shards
+        // at all or cancel every one of them.
+        if(sharded) {
+            for(auto it = m_shards.begin(); it != m_shards.end(); ++it) {
+                (*it)->start();
+            }
+        } else {
+            m_asio->post(std::bind(&accept_action_t::operator(),
+                std::make_shared<accept_action_t>(this)
+            ));
+        }
+
+        if(m_local) {
+            m_asio->post(std::bind(&local_accept_action_t::operator(),
+                std::make_shared<local_accept_action_t>(this)
+            ));
+        }
+    });
 
     // The post() above won't be executed until this thread is started.
     m_chamber = std::make_unique<io::chamber_t>(m_prototype->name(), m_asio);
@@ -237,6 +498,22 @@ actor_t::terminate() {
 
         COCAINE_LOG_INFO(m_log, "removing service from local endpoint %s", endpoint);
 
+        for(auto it = m_shards.begin(); it != m_shards.end(); ++it) {
+            (*it)->cancel();
+        }
+
+        m_shards.clear();
+
+        if(m_local) {
+            const auto path = m_local->local_endpoint(ec).path();
+
+            COCAINE_LOG_INFO(m_log, "removing service from local socket %s", path);
+
+            m_local = nullptr;
+
+            if(!path.empty()) ::unlink(path.c_str());
+        }
+
         // Does not block, unlike the one in execution_unit_t's destructors.
         m_chamber = nullptr;
         ptr       = nullptr;
@@ -24,6 +24,7 @@
 
 #include "cocaine/detail/engine.hpp"
 #include "cocaine/detail/essentials.hpp"
+#include "cocaine/detail/placement.hpp"
 
 #include "cocaine/logging.hpp"
 
@@ -203,27 +204,22 @@ context_t::locate(const std::string& name) const {
     return boost::optional<const actor_t&>(it->second->is_active(), *it->second);
 }
 
-namespace {
-
-struct utilization_t {
-    typedef std::unique_ptr<execution_unit_t> value_type;
-
-    bool
-    operator()(const value_type& lhs, const value_type& rhs) const {
-        return lhs->utilization() < rhs->utilization();
-    }
-};
-
-} // namespace
-
 execution_unit_t&
 context_t::engine() {
-    return **std::min_element(m_pool.begin(), m_pool.end(), utilization_t());
+    return m_placement->select(m_pool);
+}
+
+auto
+context_t::engines() const -> const std::vector<std::unique_ptr<execution_unit_t>>& {
+    return m_pool;
 }
 
 void
 context_t::bootstrap() {
-    COCAINE_LOG_INFO(m_logger, "starting %d execution unit(s)", config.network.pool);
+    COCAINE_LOG_INFO(m_logger, "starting %d execution unit(s), placement policy: '%s'",
+        config.network.pool, config.network.placement);
+
+    m_placement = placement_t::create(config.network.placement);
 
     while(m_pool.size() != config.network.pool) {
         m_pool.emplace_back(std::make_unique<execution_unit_t>(*this));
@@ -373,6 +373,46 @@ config_t::config_t(const std::string& source) {
         throw cocaine::error_t("network I/O pool size must be positive");
     }
 
+    network.placement = network_config.at("placement", defaults::placement).as_string();
+    network.reuseport = network_config.at("reuseport", false).as_bool();
+    network.local     = network_config.at("local", false).as_bool();
+
+    if(network_config.count("batching")) {
+        const auto batching = network_config.at("batching").as_object();
+
+        network.batching.bytes = batching.at("bytes", defaults::batching_bytes).to<uint64_t>();
+        network.batching.count = batching.at("count", defaults::batching_count).to<uint64_t>();
+        network.batching.cork  = batching.at("cork", false).as_bool();
+    } else {
+        network.batching.bytes = 0;
+        network.batching.count = 0;
+        network.batching.cork  = false;
+    }
+
+    if(network_config.count("watermarks")) {
+        const auto watermarks = network_config.at("watermarks").as_object();
+
+        const auto session = watermarks.at("session", dynamic_t::empty_object).as_object();
+        const auto engine  = watermarks.at("engine",  dynamic_t::empty_object).as_object();
+
+        // Low watermarks default to the half of the corresponding high watermarks.
+        network.watermarks.session.high = session.at("high", 0).to<uint64_t>();
+        network.watermarks.session.low  = session.at("low", network.watermarks.session.high / 2).to<uint64_t>();
+        network.watermarks.engine.high  = engine.at("high", 0).to<uint64_t>();
+        network.watermarks.engine.low   = engine.at("low", network.watermarks.engine.high / 2).to<uint64_t>();
+
+        if(network.watermarks.session.low > network.watermarks.session.high ||
+           network.watermarks.engine.low  > network.watermarks.engine.high)
+        {
+            throw cocaine::error_t("network low watermarks must not exceed high watermarks");
+        }
+    } else {
+        network.watermarks.session.high = 0;
+        network.watermarks.session.low  = 0;
+        network.watermarks.engine.high  = 0;
+        network.watermarks.engine.low   = 0;
+    }
+
     if(network_config.count("pinned")) {
         network.ports.pinned = network_config.at("pinned").to<decltype(network.ports.pinned)>();
     }
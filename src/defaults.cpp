@@ -31,6 +31,7 @@ const unsigned long defaults::concurrency      = 10L;
 const unsigned long defaults::crashlog_limit   = 50L;
 const unsigned long defaults::pool_limit       = 10L;
 const unsigned long defaults::queue_limit      = 100L;
+const unsigned long defaults::urgent_weight    = 4L;
 
 const float defaults::control_timeout          = 5.0f;
 
@@ -38,6 +39,9 @@ const std::string defaults::plugins_path       = "/usr/lib/cocaine";
 const std::string defaults::runtime_path       = "/var/run/cocaine";
 
 const std::string defaults::endpoint           = "::";
+const unsigned long defaults::batching_bytes   = 65536L;
+const unsigned long defaults::batching_count   = 64L;
+const std::string defaults::placement          = "load-average";
 
 const std::string defaults::log_verbosity      = "info";
 const std::string defaults::log_timestamp      = "%Y-%m-%d %H:%M:%S.%f";
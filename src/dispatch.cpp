@@ -20,8 +20,92 @@
 
 #include "cocaine/rpc/dispatch.hpp"
 
+#include <pthread.h>
+
 using namespace cocaine::io;
 
+namespace {
+
+// Every thread's slot, for the lookups to find it without going through the registry.
+__thread hazard_t* local_hazard = nullptr;
+
+void
+release(void* ptr) {
+    auto hazard = static_cast<hazard_t*>(ptr);
+
+    hazard->pointer.store(nullptr, std::memory_order_release);
+    hazard->acquired.store(false, std::memory_order_release);
+}
+
+// Slots are never freed, only released for reuse when their threads exit, so the list can be walked
+// without any synchronization.
+struct registry_t {
+    registry_t():
+        head(nullptr)
+    {
+        pthread_key_create(&key, &release);
+    }
+
+    pthread_key_t key;
+    std::atomic<hazard_t*> head;
+};
+
+registry_t&
+registry() {
+    static registry_t instance;
+    return instance;
+}
+
+} // namespace
+
+hazard_t&
+hazard_t::local() {
+    if(local_hazard) {
+        return *local_hazard;
+    }
+
+    auto& registry = ::registry();
+
+    for(hazard_t* it = registry.head.load(std::memory_order_acquire); it; it = it->next) {
+        bool expected = false;
+
+        if(it->acquired.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            local_hazard = it;
+            break;
+        }
+    }
+
+    if(!local_hazard) {
+        auto hazard = new hazard_t();
+
+        hazard->pointer.store(nullptr, std::memory_order_relaxed);
+        hazard->acquired.store(true, std::memory_order_relaxed);
+        hazard->next = registry.head.load(std::memory_order_relaxed);
+
+        while(!registry.head.compare_exchange_weak(hazard->next, hazard, std::memory_order_release,
+            std::memory_order_relaxed))
+        { }
+
+        local_hazard = hazard;
+    }
+
+    // Released once the thread exits.
+    pthread_setspecific(registry.key, local_hazard);
+
+    return *local_hazard;
+}
+
+bool
+hazard_t::protects(const void* pointer) {
+    for(hazard_t* it = registry().head.load(std::memory_order_acquire); it; it = it->next) {
+        if(it->pointer.load() == pointer) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 basic_dispatch_t::basic_dispatch_t(const std::string& name):
     m_name(name)
 { }
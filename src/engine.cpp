@@ -77,9 +77,10 @@ execution_unit_t::gc_action_t::finalize(const std::error_code& ec) {
     size_t recycled = 0;
 
     for(auto it = parent->m_sessions.begin(); it != parent->m_sessions.end();) {
-        if(!it->second->memory_pressure()) {
+        if(!it->second->connected()) {
             recycled++;
             it = parent->m_sessions.erase(it);
+            parent->m_active--;
             continue;
         }
 
@@ -93,19 +94,87 @@ execution_unit_t::gc_action_t::finalize(const std::error_code& ec) {
     operator()();
 }
 
+class execution_unit_t::probe_action_t:
+    public std::enable_shared_from_this<probe_action_t>
+{
+    execution_unit_t *const parent;
+    const boost::posix_time::milliseconds repeat;
+
+public:
+    template<class Interval>
+    probe_action_t(execution_unit_t *const parent_, Interval repeat_):
+        parent(parent_),
+        repeat(repeat_)
+    { }
+
+    void
+    operator()();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+void
+execution_unit_t::probe_action_t::operator()() {
+    parent->m_probe.expires_from_now(repeat);
+
+    parent->m_probe.async_wait(std::bind(&probe_action_t::finalize,
+        shared_from_this(),
+        std::placeholders::_1
+    ));
+}
+
+void
+execution_unit_t::probe_action_t::finalize(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    const auto delay = boost::posix_time::microsec_clock::universal_time() - parent->m_probe.expires_at();
+    const auto sample = static_cast<uint64_t>(std::max<int64_t>(delay.total_microseconds(), 0));
+
+    // Exponentially weighted moving average, so that a single hiccup wouldn't affect the placement
+    // much. Only this thread updates the value.
+    parent->m_lag.store((parent->m_lag.load(std::memory_order_relaxed) * 7 + sample) / 8,
+        std::memory_order_relaxed);
+
+    operator()();
+}
+
 execution_unit_t::execution_unit_t(context_t& context):
+    m_context(context),
+    m_active(0),
+    m_pending(0),
+    m_message_pool(std::make_shared<io::message_pool_t>()),
+    m_buffer_pool(std::make_shared<io::buffer_pool_t>()),
     m_asio(new io_service()),
     m_chamber(new io::chamber_t("core:asio", m_asio)),
-    m_cron(*m_asio)
+    m_cron(*m_asio),
+    m_probe(*m_asio),
+    m_lag(0)
 {
     m_log = context.log("core:asio", {
         attribute::make("engine", boost::lexical_cast<std::string>(m_chamber->thread_id()))
     });
 
+    const auto& watermarks = context.config.network.watermarks;
+
+    m_backpressure = std::make_shared<session_t::backpressure_t>(m_asio,
+        watermarks.session.high,
+        watermarks.session.low,
+        watermarks.engine.high,
+        watermarks.engine.low
+    );
+
     m_asio->post(std::bind(&gc_action_t::operator(),
         std::make_shared<gc_action_t>(this, boost::posix_time::seconds(kCollectionInterval))
     ));
 
+    m_asio->post(std::bind(&probe_action_t::operator(),
+        std::make_shared<probe_action_t>(this, boost::posix_time::milliseconds(kProbeInterval))
+    ));
+
     COCAINE_LOG_DEBUG(m_log, "engine started");
 }
 
@@ -119,6 +188,7 @@ execution_unit_t::~execution_unit_t() {
         }
 
         m_cron.cancel();
+        m_probe.cancel();
     });
 
     // NOTE: This will block until all the outstanding operations are complete.
@@ -133,44 +203,145 @@ execution_unit_t::attach(const std::shared_ptr<tcp::socket>& ptr, const io::disp
         throw std::system_error(errno, std::system_category(), "unable to clone client's socket");
     }
 
-    std::shared_ptr<session_t> session;
+    std::unique_ptr<tcp::socket> clone;
 
     try {
         // Local endpoint address of the socket to be cloned.
         const auto endpoint = ptr->local_endpoint();
 
         // Copy the socket into the new reactor.
-        auto channel = std::make_unique<io::channel<tcp>>(std::make_unique<tcp::socket>(
-           *m_asio,
-            endpoint.protocol(),
-            socket
-        ));
+        clone = std::make_unique<tcp::socket>(*m_asio, endpoint.protocol(), socket);
+    } catch(const std::system_error& e) {
+        throw std::system_error(e.code(), "client has disappeared while creating session");
+    }
+
+    return attach(std::move(clone), dispatch);
+}
+
+std::shared_ptr<session_t>
+execution_unit_t::attach(std::unique_ptr<tcp::socket> ptr, const io::dispatch_ptr_t& dispatch) {
+    std::unique_ptr<io::channel<tcp>> channel;
+    std::string endpoint;
+
+    try {
+        endpoint = boost::lexical_cast<std::string>(ptr->remote_endpoint());
+        channel  = std::make_unique<io::channel<tcp>>(std::move(ptr), m_buffer_pool);
 
         // Disable Nagle's algorithm, since most of the service clients do not send or receive more
         // than a couple of kilobytes of data.
         channel->socket->set_option(tcp::no_delay(true));
+    } catch(const std::system_error& e) {
+        throw std::system_error(e.code(), "client has disappeared while creating session");
+    }
+
+    return insert(std::move(channel), endpoint, dispatch);
+}
 
-        auto session_log = std::make_unique<logging::log_t>(*m_log, attribute::set_t({
-            attribute::make("endpoint", boost::lexical_cast<std::string>(ptr->remote_endpoint())),
-            attribute::make("service",  dispatch ? dispatch->name() : "<none>"),
-        }));
+std::shared_ptr<session_t>
+execution_unit_t::attach(const std::shared_ptr<local::stream_protocol::socket>& ptr,
+                         const io::dispatch_ptr_t& dispatch)
+{
+    int socket;
 
-        COCAINE_LOG_DEBUG(session_log, "attached connection to engine, load: %.2f%%", utilization() * 100);
+    if((socket = ::dup(ptr->native_handle())) == -1) {
+        throw std::system_error(errno, std::system_category(), "unable to clone client's socket");
+    }
 
-        // Create the new inactive session.
-        session = std::make_shared<session_t>(std::move(session_log), std::move(channel), dispatch);
+    std::unique_ptr<io::channel<local::stream_protocol>> channel;
+    std::string endpoint;
+
+    try {
+        // Local peers are unnamed, so the session is identified by the listening socket path.
+        endpoint = ptr->local_endpoint().path();
+
+        // Copy the socket into the new reactor.
+        channel = std::make_unique<io::channel<local::stream_protocol>>(
+            std::make_unique<local::stream_protocol::socket>(*m_asio, local::stream_protocol(), socket),
+            m_buffer_pool
+        );
     } catch(const std::system_error& e) {
         throw std::system_error(e.code(), "client has disappeared while creating session");
     }
 
+    return insert(std::move(channel), endpoint, dispatch);
+}
+
+template<class Protocol>
+std::shared_ptr<session_t>
+execution_unit_t::insert(std::unique_ptr<io::channel<Protocol>> channel, const std::string& endpoint,
+                         const io::dispatch_ptr_t& dispatch)
+{
+    const int socket = channel->socket->native_handle();
+
+    const auto& batching = m_context.config.network.batching;
+
+    if(batching.count) {
+        channel->writer->batch(batching.bytes, batching.count, batching.cork);
+    }
+
+    auto session_log = std::make_unique<logging::log_t>(*m_log, attribute::set_t({
+        attribute::make("endpoint", endpoint),
+        attribute::make("service",  dispatch ? dispatch->name() : "<none>"),
+    }));
+
+    COCAINE_LOG_DEBUG(session_log, "attached connection to engine, load: %.2f%%", utilization() * 100);
+
+    // Create the new inactive session.
+    const auto session = std::make_shared<session_t>(std::move(session_log), std::move(channel),
+        dispatch, m_message_pool, m_backpressure);
+
+    m_active++;
+    m_pending++;
+
     m_asio->dispatch([=]() {
-        (m_sessions[socket] = session)->pull();
+        auto& slot = m_sessions[socket];
+
+        if(slot) {
+            // The previous session on this fd has been detached, but not yet collected.
+            m_active--;
+        }
+
+        slot = session;
+        slot->bind(this, socket);
+        slot->pull();
+
+        m_pending--;
     });
 
     return session;
 }
 
+io_service&
+execution_unit_t::get_io_service() {
+    return *m_asio;
+}
+
 double
 execution_unit_t::utilization() const {
     return m_chamber->load_avg1();
 }
+
+void
+execution_unit_t::detached(session_t& session, int key) {
+    auto it = m_sessions.find(key);
+
+    // The slot might have been already reused by another session, if the fd has been recycled.
+    if(it == m_sessions.end() || it->second.get() != &session) {
+        return;
+    }
+
+    m_sessions.erase(it);
+    m_active--;
+}
+
+auto
+execution_unit_t::load() const -> load_t {
+    load_t result;
+
+    result.sessions = m_active.load(std::memory_order_relaxed);
+    result.pending  = m_pending.load(std::memory_order_relaxed);
+    result.lag      = m_lag.load(std::memory_order_relaxed);
+    result.bytes    = m_backpressure->size();
+
+    return result;
+}
@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/rpc/executor.hpp"
+
+#include "cocaine/logging.hpp"
+
+#if defined(__linux__)
+    #include <sys/prctl.h>
+#elif defined(__APPLE__)
+    #include <pthread.h>
+#endif
+
+using namespace cocaine::io;
+
+executor_t::executor_t(std::unique_ptr<logging::log_t> log, const std::string& name, size_t threads,
+                       size_t limit)
+:
+    m_log(std::move(log)),
+    m_limit(limit),
+    m_stopped(false)
+{
+    for(size_t i = 0; i < threads; ++i) {
+        m_threads.create_thread(std::bind(&executor_t::run, this, name));
+    }
+}
+
+executor_t::~executor_t() {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopped = true;
+    }
+
+    m_condition.notify_all();
+
+    // NOTE: This will block until all the queued tasks are complete.
+    m_threads.join_all();
+}
+
+bool
+executor_t::post(task_type task) {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        if(m_stopped || m_queue.size() >= m_limit) {
+            return false;
+        }
+
+        m_queue.push_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+
+    return true;
+}
+
+size_t
+executor_t::size() const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_queue.size();
+}
+
+void
+executor_t::run(const std::string& name) {
+#if defined(__linux__)
+    if(name.size() < 16) {
+        ::prctl(PR_SET_NAME, name.c_str());
+    } else {
+        ::prctl(PR_SET_NAME, name.substr(0, 16).data());
+    }
+#elif defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#endif
+
+    while(true) {
+        task_type task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_condition.wait(lock, [this] {
+                return m_stopped || !m_queue.empty();
+            });
+
+            if(m_queue.empty()) {
+                return;
+            }
+
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        // Tasks are expected to report their own errors, so whatever escapes is merely logged, as
+        // there's nobody else to report it to.
+        try {
+            task();
+        } catch(const std::exception& e) {
+            COCAINE_LOG_ERROR(m_log, "uncaught task exception: %s", e.what());
+        } catch(...) {
+            COCAINE_LOG_ERROR(m_log, "uncaught task exception: unknown");
+        }
+    }
+}
@@ -0,0 +1,146 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/rpc/asio/message_pool.hpp"
+
+#include <pthread.h>
+
+using namespace cocaine::io;
+
+namespace {
+
+struct cache_t {
+    pooled_message_t* head;
+    size_t size;
+};
+
+__thread cache_t* local_cache = nullptr;
+
+void
+destroy(void* ptr) {
+    auto cache = static_cast<cache_t*>(ptr);
+
+    while(cache->head) {
+        pooled_message_t* next = cache->head->next;
+        delete cache->head;
+        cache->head = next;
+    }
+
+    delete cache;
+}
+
+// Frees the thread caches once their threads exit.
+struct registry_t {
+    registry_t() {
+        pthread_key_create(&key, &destroy);
+    }
+
+    pthread_key_t key;
+};
+
+cache_t&
+cache() {
+    static registry_t registry;
+
+    if(local_cache == nullptr) {
+        local_cache = new cache_t();
+        local_cache->head = nullptr;
+        local_cache->size = 0;
+
+        pthread_setspecific(registry.key, local_cache);
+    }
+
+    return *local_cache;
+}
+
+} // namespace
+
+auto
+message_pool_t::acquire() -> std::unique_ptr<pooled_message_t> {
+    auto& cache = ::cache();
+
+    if(cache.head == nullptr) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Refill the cache with a batch of messages.
+        while(m_head && cache.size < kBatchSize) {
+            pooled_message_t* message = m_head;
+
+            m_head = message->next;
+            m_size--;
+
+            message->next = cache.head;
+            cache.head = message;
+            cache.size++;
+        }
+    }
+
+    if(cache.head == nullptr) {
+        return std::make_unique<pooled_message_t>();
+    }
+
+    std::unique_ptr<pooled_message_t> message(cache.head);
+
+    cache.head = message->next;
+    cache.size--;
+
+    message->next = nullptr;
+
+    return message;
+}
+
+void
+message_pool_t::recycle(std::unique_ptr<pooled_message_t> message) {
+    message->owner.reset();
+
+    // Messages which had to grow their buffers too much are not worth keeping around.
+    if(message->message.capacity() > kMaximumBufferSize) {
+        return;
+    }
+
+    message->message.clear();
+
+    auto& cache = ::cache();
+
+    if(cache.size == 2 * kBatchSize) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Spill a batch of messages, so that the threads which only encode messages could get them.
+        for(size_t i = 0; i < kBatchSize; ++i) {
+            pooled_message_t* spilled = cache.head;
+
+            cache.head = spilled->next;
+            cache.size--;
+
+            if(m_size == kMaximumPoolSize) {
+                delete spilled;
+                continue;
+            }
+
+            spilled->next = m_head;
+            m_head = spilled;
+            m_size++;
+        }
+    }
+
+    message->next = cache.head;
+    cache.head = message.release();
+    cache.size++;
+}
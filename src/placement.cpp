@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/placement.hpp"
+
+#include "cocaine/detail/engine.hpp"
+
+#include "cocaine/locked_ptr.hpp"
+
+#include <random>
+
+using namespace cocaine;
+
+namespace {
+
+struct load_average_t:
+    public placement_t
+{
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) {
+        auto it = std::min_element(pool.begin(), pool.end(),
+            [](const pool_type::value_type& lhs, const pool_type::value_type& rhs) -> bool
+        {
+            return lhs->utilization() < rhs->utilization();
+        });
+
+        return **it;
+    }
+};
+
+// Orders units by the number of sessions, which already includes those not yet started, then by
+// the number of session insertions still queued on the reactor, then by the amount of outgoing bytes
+// in flight, then by the event loop lag.
+
+bool
+lighter(const execution_unit_t::load_t& lhs, const execution_unit_t::load_t& rhs) {
+    if(lhs.sessions != rhs.sessions) {
+        return lhs.sessions < rhs.sessions;
+    }
+
+    if(lhs.pending != rhs.pending) {
+        return lhs.pending < rhs.pending;
+    }
+
+    if(lhs.bytes != rhs.bytes) {
+        return lhs.bytes < rhs.bytes;
+    }
+
+    return lhs.lag < rhs.lag;
+}
+
+struct least_connections_t:
+    public placement_t
+{
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) {
+        auto it = pool.begin();
+        auto load = (*it)->load();
+
+        for(auto candidate = std::next(it); candidate != pool.end(); ++candidate) {
+            const auto other = (*candidate)->load();
+
+            if(lighter(other, load)) {
+                it = candidate;
+                load = other;
+            }
+        }
+
+        return **it;
+    }
+};
+
+class power_of_two_t:
+    public placement_t
+{
+    synchronized<std::default_random_engine> m_rng;
+
+public:
+    power_of_two_t() {
+        std::random_device rd; m_rng.unsafe().seed(rd());
+    }
+
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) {
+        if(pool.size() == 1) {
+            return *pool.front();
+        }
+
+        std::uniform_int_distribution<size_t> first(0, pool.size() - 1);
+        std::uniform_int_distribution<size_t> offset(1, pool.size() - 1);
+
+        size_t lhs, rhs;
+
+        m_rng.apply([&](std::default_random_engine& rng) {
+            lhs = first(rng);
+
+            // Pick a different unit, so that the choice is always between two of them.
+            rhs = (lhs + offset(rng)) % pool.size();
+        });
+
+        return lighter(pool[rhs]->load(), pool[lhs]->load()) ? *pool[rhs] : *pool[lhs];
+    }
+};
+
+} // namespace
+
+std::unique_ptr<placement_t>
+placement_t::create(const std::string& name) {
+    if(name == "load-average") {
+        return std::make_unique<load_average_t>();
+    } else if(name == "least-connections") {
+        return std::make_unique<least_connections_t>();
+    } else if(name == "power-of-two") {
+        return std::make_unique<power_of_two_t>();
+    }
+
+    throw cocaine::error_t("unknown placement policy '%s'", name);
+}
@@ -106,7 +106,7 @@ private:
     cleanup();
 
     void
-    on_announce(const std::string& node, std::map<std::string, results::resolve>&& update);
+    on_announce(const std::string& node, std::map<std::string, results::meta>&& update);
 
     void
     on_shutdown();
@@ -138,7 +138,7 @@ locator_t::remote_t::cleanup() {
 
 void
 locator_t::remote_t::on_announce(const std::string& node,
-                                 std::map<std::string, results::resolve>&& update)
+                                 std::map<std::string, results::meta>&& update)
 {
     if(node != uuid) {
         COCAINE_LOG_ERROR(parent->m_log, "remote client id mismatch: '%s' vs. '%s'", uuid, node);
@@ -231,7 +231,7 @@ public:
                 "service", handle
             );
 
-            parent->on_service(handle, results::resolve{endpoints, 0, graph_root_t{}}, 1);
+            parent->on_service(handle, results::meta{endpoints, 0, graph_root_t{}}, 1);
 
             return std::make_shared<expose_lock_t>(this, handle);
         });
@@ -248,7 +248,7 @@ private:
             "service", handle
         );
 
-        return parent->on_service(handle, results::resolve{}, 0);
+        return parent->on_service(handle, results::meta{}, 0);
     }
 };
 
@@ -272,7 +272,9 @@ locator_t::locator_t(context_t& context, io_service& asio, const std::string& na
 {
     using namespace std::placeholders;
 
-    on<locator::resolve>(std::bind(&locator_t::on_resolve, this, _1, _2));
+    on<locator::resolve>(std::make_shared<io::blocking_slot<locator::resolve, results::resolve>>(
+        std::bind(&locator_t::on_resolve, this, _1, _2)
+    ));
     on<locator::connect>(std::bind(&locator_t::on_connect, this, _1));
     on<locator::refresh>(std::bind(&locator_t::on_refresh, this, _1));
     on<locator::cluster>(std::bind(&locator_t::on_cluster, this));
@@ -463,7 +465,8 @@ locator_t::on_resolve(const std::string& name, const std::string& seed) const {
         return results::resolve {
             provided.get().endpoints(),
             provided.get().prototype().version(),
-            provided.get().prototype().root()
+            provided.get().prototype().root(),
+            provided.get().local_endpoint()
         };
     }
 
@@ -476,7 +479,8 @@ locator_t::on_resolve(const std::string& name, const std::string& seed) const {
         return results::resolve {
             m_gateway->resolve(api::gateway_t::partition_t{remapped, proto.first}),
             proto.first,
-            proto.second
+            proto.second,
+            std::string()
         };
     } else {
         throw std::system_error(error::service_not_available);
@@ -618,7 +622,7 @@ locator_t::on_routing(const std::string& ruid, bool replace) -> streamed<results
 }
 
 void
-locator_t::on_service(const std::string& name, const results::resolve& meta, bool active) {
+locator_t::on_service(const std::string& name, const results::meta& meta, bool active) {
     if(m_cfg.restricted.count(name)) {
         return;
     }
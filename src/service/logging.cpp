@@ -64,7 +64,7 @@ logging_t::prototype() const {
 }
 
 void
-logging_t::on_emit(logging::priorities level, std::string&& source, std::string&& message,
+logging_t::on_emit(logging::priorities level, const string_view_t& source, const string_view_t& message,
                    blackhole::attribute::set_t&& attributes)
 {
     auto record = m_logger->open_record(level, std::move(attributes));
@@ -73,8 +73,9 @@ logging_t::on_emit(logging::priorities level, std::string&& source, std::string&
         return;
     }
 
-    record.insert(cocaine::logging::keyword::source() = std::move(source));
-    record.message(std::move(message));
+    // The only copies of the source and the message, for records which passed the filtering.
+    record.insert(cocaine::logging::keyword::source() = source.str());
+    record.message(message.str());
 
     m_logger->push(std::move(record));
 }
@@ -60,6 +60,56 @@ namespace fs = boost::filesystem;
 
 namespace {
 
+// Timeouts are converted to steady clock durations, which would overflow for huge values, so anything
+// longer than a day is rejected.
+const double kMaximumTimeout = 86400.0;
+
+// Builds the event execution policy out of the optional enqueue argument. The timeout is relative,
+// so that the deadline is computed using the local steady clock on arrival.
+
+api::policy_t
+policy_of(const dynamic_t& header) {
+    typedef api::policy_t::clock_type clock_type;
+
+    api::policy_t policy;
+
+    if(header.is_null()) {
+        return policy;
+    }
+
+    if(!header.is_object()) {
+        throw cocaine::error_t("event policy must be an object");
+    }
+
+    const auto& object = header.as_object();
+
+    try {
+        policy.urgent   = object.at("urgent", false).as_bool();
+        policy.priority = object.at("priority", 0u).to<uint64_t>();
+        policy.timeout  = object.at("timeout", 0.0).to<double>();
+        policy.tenant   = object.at("tenant", "").as_string();
+    } catch(const std::exception& e) {
+        throw cocaine::error_t("event policy is malformed - %s", e.what());
+    }
+
+    // NOTE: Written this way to reject NaNs as well.
+    if(!(policy.timeout >= 0.0)) {
+        throw cocaine::error_t("event timeout must be non-negative");
+    }
+
+    if(policy.timeout > kMaximumTimeout) {
+        throw cocaine::error_t("event timeout must not exceed %.0f seconds", kMaximumTimeout);
+    }
+
+    if(policy.timeout > 0.0) {
+        policy.deadline = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(policy.timeout)
+        );
+    }
+
+    return policy;
+}
+
 class streaming_service_t:
     public dispatch<event_traits<app::enqueue>::dispatch_type>
 {
@@ -77,6 +127,13 @@ public:
         on<protocol::choke>(std::bind(&streaming_service_t::close, this));
     }
 
+    // The client has gone away before closing the stream, so there's nobody to read the results.
+    virtual
+    void
+    discard(const std::error_code& COCAINE_UNUSED_(ec)) const {
+        downstream->cancel();
+    }
+
 private:
     void
     write(const std::string& chunk) {
@@ -117,7 +174,7 @@ private:
         operator()(tuple_type&& args, upstream_type&& upstream) {
             return tuple::invoke(
                 std::move(args),
-                std::bind(&app_service_t::enqueue, parent, std::ref(upstream), ph::_1, ph::_2)
+                std::bind(&app_service_t::enqueue, parent, std::ref(upstream), ph::_1, ph::_2, ph::_3)
             );
         }
 
@@ -152,18 +209,39 @@ private:
             upstream.send<protocol::choke>();
         }
 
+        // Worker chunks and errors have exactly the same arguments as the client protocol ones, so
+        // they are copied into the outgoing messages as is.
+
+        virtual
+        bool
+        splice_chunk(const char* args, size_t size) {
+            upstream = upstream.send<protocol::chunk>(io::raw_sequence_t { args, size });
+            return true;
+        }
+
+        virtual
+        bool
+        splice_error(const char* args, size_t size) {
+            upstream.send<protocol::error>(io::raw_sequence_t { args, size });
+            return true;
+        }
+
     private:
         enqueue_slot_t::upstream_type upstream;
     };
 
     std::shared_ptr<const enqueue_slot_t::dispatch_type>
-    enqueue(enqueue_slot_t::upstream_type& upstream, const std::string& event, const std::string& tag) {
+    enqueue(enqueue_slot_t::upstream_type& upstream, const std::string& event, const std::string& tag,
+            const dynamic_t& policy)
+    {
         api::stream_ptr_t downstream;
 
+        const api::event_t target(event, policy_of(policy));
+
         if(tag.empty()) {
-            downstream = parent->enqueue(api::event_t(event), std::make_shared<engine_stream_adapter_t>(upstream));
+            downstream = parent->enqueue(target, std::make_shared<engine_stream_adapter_t>(upstream));
         } else {
-            downstream = parent->enqueue(api::event_t(event), std::make_shared<engine_stream_adapter_t>(upstream), tag);
+            downstream = parent->enqueue(target, std::make_shared<engine_stream_adapter_t>(upstream), tag);
         }
 
         return std::make_shared<const streaming_service_t>(name(), downstream);
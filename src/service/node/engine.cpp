@@ -23,9 +23,11 @@
 #include "cocaine/context.hpp"
 
 #include "cocaine/detail/service/node/event.hpp"
+#include "cocaine/detail/service/node/index.hpp"
 #include "cocaine/detail/service/node/manifest.hpp"
 #include "cocaine/detail/service/node/profile.hpp"
 #include "cocaine/detail/service/node/session.hpp"
+#include "cocaine/detail/service/node/shm.hpp"
 #include "cocaine/detail/service/node/slave.hpp"
 #include "cocaine/detail/service/node/stream.hpp"
 
@@ -50,6 +52,8 @@
 
 #include <boost/filesystem/operations.hpp>
 
+#include <asio/write.hpp>
+
 using namespace cocaine;
 using namespace cocaine::engine;
 using namespace cocaine::io;
@@ -112,61 +116,21 @@ private:
 
 } // namespace
 
-namespace {
-
-struct load {
-    template<class T>
-    bool
-    operator()(const T& lhs, const T& rhs) const {
-        return lhs.second->load() < rhs.second->load();
-    }
-};
-
-struct available {
-    template<class T>
-    bool
-    operator()(const T& slave) const {
-        return slave.second->active() && slave.second->load() < max;
-    }
-
-    const size_t max;
-};
-
-template<class It, class Compare, class Predicate>
-inline
-It
-min_element_if(It first, It last, Compare compare, Predicate predicate) {
-    while(first != last && !predicate(*first)) {
-        ++first;
-    }
-
-    if(first == last) {
-        return last;
-    }
-
-    It result = first;
-
-    while(++first != last) {
-        if(predicate(*first) && compare(*first, *result)) {
-            result = first;
-        }
-    }
-
-    return result;
-}
-
-} // namespace
-
 engine_t::engine_t(context_t& context, const manifest_t& manifest, const profile_t& profile):
     m_context(context),
     m_log(context.log(manifest.name)),
     m_manifest(manifest),
     m_profile(profile),
+    m_index(profile.concurrency),
     m_state(states::stopped),
     m_termination_timer(m_loop),
+    m_respawn_timer(m_loop),
+    m_failures(0),
+    m_backoff(false),
     m_socket(m_loop),
     m_acceptor(m_loop, protocol_type::endpoint(m_manifest.endpoint)),
-    m_next_id(1)
+    m_next_id(1),
+    m_queue(m_profile)
 {
     m_isolate = m_context.get<api::isolate_t>(
         m_profile.isolate.type,
@@ -201,6 +165,10 @@ engine_t::run() {
     );
 
     m_state = states::running;
+
+    // Warm the pool up right away, if configured to.
+    wake();
+
     std::error_code ec;
     m_loop.run(ec);
     if(ec) {
@@ -219,12 +187,10 @@ engine_t::enqueue(const api::event_t& event, const std::shared_ptr<api::stream_t
 
     auto session = std::make_shared<session_t>(m_next_id++, event, upstream);
 
-    std::lock_guard<session_queue_t> lock(m_queue);
-    if(m_profile.queue_limit > 0 && m_queue.size() >= m_profile.queue_limit) {
+    if(!m_queue.push(session)) {
         throw cocaine::error_t("the queue is full");
     }
 
-    m_queue.push(session);
     wake();
     return std::make_shared<session_t::downstream_t>(session);
 }
@@ -256,9 +222,12 @@ engine_t::enqueue(const api::event_t& event, const std::shared_ptr<api::stream_t
                         tag,
                         m_manifest,
                         m_profile,
+                        m_estimator,
+                        m_index,
                         m_context,
                         std::bind(&engine_t::wake, this),
                         std::bind(&engine_t::erase, this, ph::_1, ph::_2, ph::_3),
+                        std::bind(&engine_t::retirable, this),
                         m_loop
                     )
                 )
@@ -266,7 +235,8 @@ engine_t::enqueue(const api::event_t& event, const std::shared_ptr<api::stream_t
         }
     }
 
-    it->second->assign(session);
+    // The assignment accounting and the load index are owned by the engine thread.
+    m_loop.post(std::bind(&slave_t::assign, it->second, session));
 
     return std::make_shared<session_t::downstream_t>(session);
 }
@@ -276,7 +246,23 @@ engine_t::erase(const std::string& id, int code, const std::string& reason) {
     COCAINE_LOG_DEBUG(m_log, "erasing slave '%s' from the pool", id);
 
     std::lock_guard<std::mutex> lock(m_pool_mutex);
-    m_pool.erase(id);
+
+    auto it = m_pool.find(id);
+    if(it != m_pool.end()) {
+        if(!it->second->activated() && m_state == states::running) {
+            const unsigned int delay = 1U << std::min(m_failures++, 6U);
+
+            COCAINE_LOG_WARNING(m_log, "slave '%s' has failed to start, delaying respawns for %d seconds",
+                id, delay);
+
+            m_backoff = true;
+            m_respawn_timer.expires_from_now(boost::posix_time::seconds(delay));
+            m_respawn_timer.async_wait(std::bind(&engine_t::on_respawn, this, ph::_1));
+        }
+
+        m_index.remove(it->second.get());
+        m_pool.erase(it);
+    }
 
     if(code == rpc::terminate::abnormal) {
         COCAINE_LOG_ERROR(m_log, "the app seems to be broken: %s", reason);
@@ -316,13 +302,12 @@ engine_t::do_info(std::function<void(dynamic_t::object_t)> callback) {
         std::bind<bool>(std::ref(collector), ph::_1)
     );
 
-    std::lock_guard<session_queue_t> qlock(m_queue);
     dynamic_t::object_t info;
     info["profile"] = m_profile.name;
     info["load-median"] = dynamic_t::uint_t(collector.median());
     info["queue"] = dynamic_t::object_t(
         {
-            { "capacity", dynamic_t::uint_t(m_profile.queue_limit) },
+            { "capacity", dynamic_t::uint_t(m_queue.capacity()) },
             { "depth",    dynamic_t::uint_t(m_queue.size()) }
         }
     );
@@ -375,6 +360,12 @@ engine_t::on_connection(std::unique_ptr<protocol_type::socket>&& socket) {
 
     COCAINE_LOG_DEBUG(m_log, "initiating a slave handshake from %d fd", fd);
     auto channel = std::make_shared<io::channel<protocol_type>>(std::move(socket));
+
+    if(m_profile.handoff_threshold) {
+        // Workers attach memfds to the blobs, see slave_t::on_blob().
+        channel->reader->enable_descriptors();
+    }
+
     channel->reader->read(
         m_message,
         std::bind(&engine_t::on_maybe_handshake, this, ph::_1, fd)
@@ -405,10 +396,12 @@ engine_t::on_handshake(int fd, const decoder_t::message_type& message) {
     m_backlog.erase(fd);
 
     std::string id;
+    uint64_t capacity;
+    bool cancellation;
     try {
         io::type_traits<
             typename io::event_traits<rpc::handshake>::argument_type
-        >::unpack(message.args(), id);
+        >::unpack(message.args(), id, capacity, cancellation);
     } catch(const std::exception& e) {
         COCAINE_LOG_WARNING(m_log, "disconnecting an incompatible slave on %d fd: %s", fd, e.what());
         return;
@@ -425,8 +418,57 @@ engine_t::on_handshake(int fd, const decoder_t::message_type& message) {
         }
     }
 
-    COCAINE_LOG_DEBUG(m_log, "slave '%s' on %d fd connected", id, fd);
-    it->second->bind(channel);
+    std::shared_ptr<ring_transport_t> rings;
+
+    if(m_profile.ring_capacity && capacity >= 4096) {
+        size_t size = m_profile.ring_capacity;
+
+        // Both capacities must be powers of two, so the largest one supported by both parties is
+        // simply the minimum of the two.
+        while(size > capacity) {
+            size /= 2;
+        }
+
+        try {
+            rings = std::make_shared<ring_transport_t>(m_manifest.name + ":" + id, size);
+        } catch(const std::system_error& e) {
+            COCAINE_LOG_WARNING(m_log, "unable to create shared rings for slave '%s', falling back to "
+                "the socket: [%d] %s", id, e.code().value(), e.code().message());
+        }
+
+        if(rings) {
+            const io::encoded<rpc::rings> announce(1, static_cast<uint64_t>(size));
+
+            try {
+                // The worker has to receive the memfd along with the announce, so it's written
+                // directly to the socket, which is not used by anyone else yet.
+                send_descriptor(channel->socket->native_handle(), announce.data(), announce.size(),
+                    rings->fd());
+            } catch(const std::system_error& e) {
+                COCAINE_LOG_ERROR(m_log, "disconnecting slave '%s' on %d fd, unable to share rings: "
+                    "[%d] %s", id, fd, e.code().value(), e.code().message());
+                return;
+            }
+        }
+    }
+
+    if(m_profile.handoff_threshold) {
+        const io::encoded<rpc::handoff> announce(1, static_cast<uint64_t>(m_profile.handoff_threshold));
+
+        std::error_code ec;
+
+        // Same as above, the socket is not used by anyone else yet.
+        asio::write(*channel->socket, asio::buffer(announce.data(), announce.size()), ec);
+
+        if(ec) {
+            COCAINE_LOG_ERROR(m_log, "disconnecting slave '%s' on %d fd, unable to announce hand-off: "
+                "[%d] %s", id, fd, ec.value(), ec.message());
+            return;
+        }
+    }
+
+    COCAINE_LOG_DEBUG(m_log, "slave '%s' on %d fd connected%s", id, fd, rings ? " via shared rings" : "");
+    it->second->bind(channel, rings, cancellation);
 }
 
 void
@@ -444,42 +486,50 @@ engine_t::on_termination(const std::error_code& ec) {
         return;
     }
 
-    std::lock_guard<session_queue_t> queue_guard(m_queue);
     COCAINE_LOG_WARNING(m_log, "forcing the engine termination due to timeout");
     stop();
 }
 
 void
 engine_t::pump() {
+    typedef api::policy_t::clock_type clock_type;
+
     session_queue_t::value_type session;
 
+    std::vector<session_queue_t::value_type> hopeless;
+
+    // Drop the sessions which won't make it in time, even if there're no slaves available right now
+    // to pick up the rest of the queue.
+    m_queue.shed(m_estimator, hopeless);
+
+    for(auto it = hopeless.begin(); it != hopeless.end(); ++it) {
+        COCAINE_LOG_DEBUG(m_log, "session %d won't make its deadline, dropping", (*it)->id);
+        (*it)->upstream->error(error::deadline_error, "the session won't make its deadline");
+    }
+
     while(!m_queue.empty()) {
         std::lock_guard<std::mutex> pool_guard(m_pool_mutex);
 
-        const auto it = min_element_if(m_pool.begin(), m_pool.end(), load(), available {
-            m_profile.concurrency
-        });
+        slave_t* slave = m_index.pick();
 
-        if(it == m_pool.end()) {
+        if(slave == nullptr) {
             return;
         }
 
-        {
-            std::lock_guard<session_queue_t> lock(m_queue);
-            if(m_queue.empty()) {
-                return;
-            }
-
-            // Move out a new session from the queue.
-            session = std::move(m_queue.front());
+        // Move out a new session from the queue.
+        if(!m_queue.pop(session)) {
+            return;
+        }
 
-            // Destroy an empty session husk.
-            m_queue.pop_front();
+        // Early shedding is a part of the deadline first mode, otherwise the sessions only expire
+        // once their deadlines pass, see slave_t::do_assign().
+        if(m_profile.deadline_first && m_estimator.hopeless(session->event, clock_type::now())) {
+            COCAINE_LOG_DEBUG(m_log, "session %d won't make its deadline, dropping", session->id);
+            session->upstream->error(error::deadline_error, "the session won't make its deadline");
+            continue;
         }
 
-        // Process the queue head outside the lock, because it might take some considerable amount
-        // of time if the session has expired and there's some heavy-lifting in the error handler.
-        it->second->assign(session);
+        slave->assign(session);
     }
 }
 
@@ -487,19 +537,32 @@ void
 engine_t::balance() {
     std::lock_guard<std::mutex> pool_guard(m_pool_mutex);
 
-    if(m_pool.size() >= m_profile.pool_limit ||
-       m_pool.size() * m_profile.grow_threshold >= m_queue.size())
-    {
+    // Once some slave has managed to start, the app is considered to be fine again.
+    const bool recovered = m_failures && std::any_of(m_pool.begin(), m_pool.end(),
+        [](const pool_map_t::value_type& slave) { return slave.second->active(); }
+    );
+
+    if(recovered) {
+        m_failures = 0;
+    }
+
+    if(m_state != states::running || m_pool.size() >= m_profile.pool_limit || m_backoff) {
         return;
     }
 
-    const unsigned int target = std::min(
-        m_profile.pool_limit,
-        std::max(
-            1UL,
-            m_queue.size() / m_profile.grow_threshold
-        )
-    );
+    size_t target = std::max<size_t>(m_pool.size(), m_profile.pool_minimum);
+
+    if(m_pool.size() * m_profile.grow_threshold < m_queue.size()) {
+        target = std::max<size_t>(target, std::max(1UL, m_queue.size() / m_profile.grow_threshold));
+    }
+
+    if(m_index.spares() < m_profile.spare_minimum) {
+        // Spawn the replacements for the spare slaves which have been taken by the sessions, so that
+        // the next burst won't wait for them to start.
+        target = std::max<size_t>(target, m_pool.size() + m_profile.spare_minimum - m_index.spares());
+    }
+
+    target = std::min<size_t>(target, m_profile.pool_limit);
 
     if(target <= m_pool.size()) {
         return;
@@ -513,18 +576,38 @@ engine_t::balance() {
             id,
             m_manifest,
             m_profile,
+            m_estimator,
+            m_index,
             m_context,
             std::bind(&engine_t::wake, this),
             std::bind(&engine_t::erase, this, ph::_1, ph::_2, ph::_3),
+            std::bind(&engine_t::retirable, this),
             m_loop
         );
     }
 }
 
 void
-engine_t::migrate(states target) {
-    std::lock_guard<session_queue_t> lock(m_queue);
+engine_t::on_respawn(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    m_backoff = false;
 
+    balance();
+}
+
+bool
+engine_t::retirable() {
+    std::lock_guard<std::mutex> pool_guard(m_pool_mutex);
+
+    // Retiring a slave both shrinks the pool and takes away one of the spares.
+    return m_pool.size() > m_profile.pool_minimum && m_index.spares() > m_profile.spare_minimum;
+}
+
+void
+engine_t::migrate(states target) {
     m_state = target;
 
     if(!m_queue.empty()) {
@@ -534,14 +617,14 @@ engine_t::migrate(states target) {
             m_queue.size()
         );
 
+        session_queue_t::value_type session;
+
         // Abort all the outstanding sessions.
-        while(!m_queue.empty()) {
-            m_queue.front()->upstream->error(
+        while(m_queue.pop(session)) {
+            session->upstream->error(
                 error::resource_error,
                 "engine is shutting down"
             );
-
-            m_queue.pop_front();
         }
     }
 
@@ -576,6 +659,7 @@ engine_t::stop() {
     COCAINE_LOG_DEBUG(m_log, "stopping '%s' engine", m_manifest.name);
     m_acceptor.cancel();
     m_termination_timer.cancel();
+    m_respawn_timer.cancel();
 
     // NOTE: This will force the slave pool termination.
     m_pool.clear();
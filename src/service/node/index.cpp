@@ -0,0 +1,83 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/service/node/index.hpp"
+
+#include "cocaine/detail/service/node/slave.hpp"
+
+using namespace cocaine::engine;
+
+load_index_t::load_index_t(size_t concurrency):
+    m_concurrency(concurrency)
+{ }
+
+void
+load_index_t::update(slave_t* slave) {
+    const size_t occupancy = slave->occupancy();
+
+    if(slave->spare()) {
+        m_spares.insert(slave);
+    } else {
+        m_spares.erase(slave);
+    }
+
+    if(!slave->active() || occupancy >= m_concurrency) {
+        unindex(slave);
+        return;
+    }
+
+    auto it = m_slaves.find(slave);
+
+    if(it != m_slaves.end()) {
+        if(it->second == occupancy) {
+            return;
+        }
+
+        m_index.erase(std::make_pair(it->second, slave));
+        it->second = occupancy;
+    } else {
+        m_slaves.insert(std::make_pair(slave, occupancy));
+    }
+
+    m_index.insert(std::make_pair(occupancy, slave));
+}
+
+void
+load_index_t::remove(slave_t* slave) {
+    m_spares.erase(slave);
+    unindex(slave);
+}
+
+auto
+load_index_t::pick() const -> slave_t* {
+    return m_index.empty() ? nullptr : m_index.begin()->second;
+}
+
+void
+load_index_t::unindex(slave_t* slave) {
+    auto it = m_slaves.find(slave);
+
+    if(it == m_slaves.end()) {
+        return;
+    }
+
+    m_index.erase(std::make_pair(it->second, slave));
+    m_slaves.erase(it);
+}
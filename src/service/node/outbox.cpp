@@ -0,0 +1,206 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cocaine/detail/service/node/outbox.hpp"
+
+#include "cocaine/detail/service/node/session.hpp"
+#include "cocaine/detail/service/node/shm.hpp"
+
+#include "cocaine/idl/rpc.hpp"
+
+using namespace cocaine::engine;
+using namespace cocaine::io;
+
+class outbox_t::write_handler_t {
+    // Writer might outlive the outbox.
+    const std::weak_ptr<outbox_t> outbox;
+
+public:
+    write_handler_t(const std::shared_ptr<outbox_t>& outbox_):
+        outbox(outbox_)
+    { }
+
+    void
+    operator()(const std::error_code& ec) const {
+        if(const auto ptr = outbox.lock()) ptr->on_write(ec);
+    }
+};
+
+outbox_t::outbox_t(asio::io_service& asio, const std::shared_ptr<stream_type>& downstream,
+                   const std::shared_ptr<ring_transport_t>& rings):
+    m_asio(asio),
+    m_downstream(downstream),
+    m_rings(rings),
+    m_head(nullptr),
+    m_tail(nullptr),
+    m_bound(false),
+    m_waiting_head(nullptr),
+    m_waiting_tail(nullptr)
+{ }
+
+outbox_t::~outbox_t() {
+    // NOTE: The connection is expected to be closed by now, so the messages can be safely dropped.
+    while(m_head) {
+        std::unique_ptr<pooled_message_t> message(m_head);
+
+        m_head = message->next;
+        m_pool.recycle(std::move(message));
+    }
+
+    while(m_waiting_head) {
+        std::unique_ptr<pooled_message_t> message(m_waiting_head);
+
+        m_waiting_head = message->next;
+        m_pool.recycle(std::move(message));
+    }
+
+    for(pooled_message_t* message = m_queue.drain(); message;) {
+        pooled_message_t* next = message->next;
+        m_pool.recycle(std::unique_ptr<pooled_message_t>(message));
+        message = next;
+    }
+}
+
+void
+outbox_t::flush() {
+    shared_ring_t& ring = m_rings->tx();
+
+    bool doorbell = false;
+
+    while(m_waiting_head) {
+        pooled_message_t* message = m_waiting_head;
+
+        const size_t size = message->message.size();
+        const bool oversized = shared_ring_t::kFrameHeader + size > ring.capacity();
+
+        // Messages which never fit into the ring are written to the socket, leaving an empty marker
+        // frame in the ring, so that the worker would handle them in order. The doorbell for the
+        // frames ahead of the marker is rung before the message is written.
+        const bool pushed = oversized ?
+            ring.push(message->message.data(), 0, doorbell) :
+            ring.push(message->message.data(), size, doorbell);
+
+        if(!pushed) {
+            if(ring.wait(oversized ? 0 : size)) {
+                // The worker will ring the doorbell once it frees some space.
+                break;
+            }
+
+            continue;
+        }
+
+        if((m_waiting_head = message->next) == nullptr) {
+            m_waiting_tail = nullptr;
+        }
+
+        if(oversized) {
+            // The worker must see the frames ahead of the marker before the message itself.
+            if(doorbell) {
+                notify();
+                doorbell = false;
+            }
+
+            do_push(message);
+        } else {
+            // The message has been copied into the ring, so it's complete.
+            m_pool.recycle(std::unique_ptr<pooled_message_t>(message));
+        }
+    }
+
+    if(doorbell) {
+        notify();
+    }
+}
+
+void
+outbox_t::notify() {
+    auto message = m_pool.acquire();
+
+    io::encoded<rpc::doorbell>::encode(message->message, 1);
+
+    do_push(message.release());
+}
+
+void
+outbox_t::do_drain() {
+    for(pooled_message_t* message = m_queue.drain(); message;) {
+        pooled_message_t* next = message->next;
+
+        if(m_rings) {
+            message->next = nullptr;
+
+            if(m_waiting_tail) {
+                m_waiting_tail->next = message;
+            } else {
+                m_waiting_head = message;
+            }
+
+            m_waiting_tail = message;
+        } else {
+            do_push(message);
+        }
+
+        message = next;
+    }
+
+    if(m_rings) {
+        flush();
+    }
+}
+
+void
+outbox_t::do_push(pooled_message_t* message) {
+    message->next = nullptr;
+
+    if(m_tail) {
+        m_tail->next = message;
+    } else {
+        m_head = message;
+    }
+
+    m_tail = message;
+
+    if(!m_bound) {
+        m_downstream->bind(write_handler_t(shared_from_this()));
+        m_bound = true;
+    }
+
+    m_downstream->write(message->message);
+}
+
+void
+outbox_t::on_write(const std::error_code& ec) {
+    BOOST_ASSERT(m_head != nullptr);
+
+    // Messages are completed in the same order they were written.
+    std::unique_ptr<pooled_message_t> message(m_head);
+
+    if((m_head = message->next) == nullptr) {
+        m_tail = nullptr;
+    }
+
+    // The session is kept alive by its message until it's recycled. Doorbells have no sessions.
+    const auto session = std::static_pointer_cast<session_t>(message->owner);
+
+    m_pool.recycle(std::move(message));
+
+    if(ec && session) {
+        session->close();
+    }
+}
@@ -24,6 +24,8 @@
 
 #include "cocaine/traits/dynamic.hpp"
 
+#include <algorithm>
+
 using namespace cocaine::engine;
 
 profile_t::profile_t(context_t& context, const std::string& name_):
@@ -39,11 +41,37 @@ profile_t::profile_t(context_t& context, const std::string& name_):
     crashlog_limit      = as_object().at("crashlog-limit", defaults::crashlog_limit).to<uint64_t>();
     pool_limit          = as_object().at("pool-limit", defaults::pool_limit).to<uint64_t>();
     queue_limit         = as_object().at("queue-limit", defaults::queue_limit).to<uint64_t>();
+    pool_minimum        = as_object().at("pool-minimum", 0).to<uint64_t>();
+    spare_minimum       = as_object().at("spare-minimum", 0).to<uint64_t>();
+    ring_capacity       = as_object().at("ring-capacity", 0).to<uint64_t>();
+    handoff_threshold   = as_object().at("handoff-threshold", 0).to<uint64_t>();
 
     unsigned long default_threshold = std::max(1UL, queue_limit / pool_limit / 2);
 
     grow_threshold      = as_object().at("grow-threshold", default_threshold).to<uint64_t>();
 
+    // Scheduling
+
+    const auto priority_config = as_object().at("priority-weights", dynamic_t::array_t()).as_array();
+
+    for(auto it = priority_config.begin(); it != priority_config.end(); ++it) {
+        priority_weights.push_back(it->to<uint64_t>());
+    }
+
+    if(priority_weights.empty()) {
+        // Normal and urgent levels.
+        priority_weights.push_back(1);
+        priority_weights.push_back(defaults::urgent_weight);
+    }
+
+    deadline_first      = as_object().at("deadline-first", false).as_bool();
+
+    const auto weights_config = as_object().at("weights", dynamic_t::object_t()).as_object();
+
+    for(auto it = weights_config.begin(); it != weights_config.end(); ++it) {
+        flow_weights[it->first] = it->second.to<uint64_t>();
+    }
+
     // Isolation
 
     const auto isolate_config = as_object().at("isolate", dynamic_t::object_t()).as_object();
@@ -78,5 +106,21 @@ profile_t::profile_t(context_t& context, const std::string& name_):
     if(concurrency == 0) {
         throw cocaine::error_t("engine concurrency must be positive");
     }
+
+    if(pool_minimum > pool_limit || spare_minimum > pool_limit) {
+        throw cocaine::error_t("engine pool minimums must not exceed the pool limit");
+    }
+
+    if(std::count(priority_weights.begin(), priority_weights.end(), 0UL) ||
+       std::count_if(flow_weights.begin(), flow_weights.end(), [](const std::pair<const std::string, unsigned long>& weight) {
+           return weight.second == 0;
+       }))
+    {
+        throw cocaine::error_t("engine scheduling weights must be positive");
+    }
+
+    if(ring_capacity != 0 && (ring_capacity < 4096 || (ring_capacity & (ring_capacity - 1)) != 0)) {
+        throw cocaine::error_t("slave ring capacity must be a power of two, at least 4096 bytes");
+    }
 }
 
@@ -19,15 +19,355 @@
 */
 
 #include "cocaine/detail/service/node/queue.hpp"
+
+#include "cocaine/detail/service/node/event.hpp"
+#include "cocaine/detail/service/node/profile.hpp"
 #include "cocaine/detail/service/node/session.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+
 using namespace cocaine::engine;
 
+namespace {
+
+size_t
+ring_capacity(size_t limit) {
+    size_t capacity = 1;
+
+    while(capacity < limit) {
+        capacity <<= 1;
+    }
+
+    return capacity;
+}
+
+} // namespace
+
+struct session_queue_t::flow_t {
+    std::string name;
+    unsigned long weight;
+
+    // Number of sessions this flow can still take in the current round.
+    unsigned long deficit;
+
+    std::deque<value_type> sessions;
+};
+
+struct session_queue_t::deadline_t {
+    api::policy_t::clock_type::time_point deadline;
+    uint64_t sequence;
+    value_type session;
+
+    // Inverted, so that the standard heap algorithms build a min-heap.
+    bool
+    operator<(const deadline_t& other) const {
+        return deadline > other.deadline || (deadline == other.deadline && sequence > other.sequence);
+    }
+};
+
+struct session_queue_t::level_t {
+    explicit
+    level_t(size_t capacity, unsigned long weight_):
+        ring(capacity),
+        weight(weight_),
+        deficit(0)
+    { }
+
+    aux::bounded_ring_t<value_type> ring;
+
+    unsigned long weight;
+    unsigned long deficit;
+
+    // Flows with staged sessions, in the round-robin order. Emptied flows are dropped right away, so
+    // that the map doesn't grow with every event name or tenant ever seen.
+    std::unordered_map<std::string, flow_t> flows;
+    std::deque<flow_t*> active;
+
+    // Staged sessions in the deadline first mode.
+    std::vector<deadline_t> deadlines;
+
+    bool
+    empty() const {
+        return active.empty() && deadlines.empty();
+    }
+};
+
 void
-session_queue_t::push(const_reference session) {
-    if(session->event.policy.urgent) {
-        emplace_front(session);
-    } else {
-        emplace_back(session);
+deadline_estimator_t::observe(const std::string& event, clock_type::duration elapsed) {
+    const auto now = clock_type::now();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto it = m_samples.find(event);
+
+    if(it == m_samples.end()) {
+        m_samples.insert(std::make_pair(event, sample_t{elapsed, now}));
+        return;
+    }
+
+    const auto estimate = decayed(it->second, now);
+
+    // Exponentially weighted moving average with 1/8 smoothing factor.
+    it->second.estimate = estimate + (elapsed - estimate) / 8;
+    it->second.updated  = now;
+}
+
+bool
+deadline_estimator_t::hopeless(const api::event_t& event, clock_type::time_point now) const {
+    const auto& policy = event.policy;
+
+    return policy.deadline > clock_type::time_point() &&
+           policy.deadline <= now + estimate(event.name, now);
+}
+
+auto
+deadline_estimator_t::estimate(const std::string& event, clock_type::time_point now) const
+    -> clock_type::duration
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto it = m_samples.find(event);
+
+    if(it == m_samples.end()) {
+        return clock_type::duration::zero();
+    }
+
+    return decayed(it->second, now);
+}
+
+auto
+deadline_estimator_t::decayed(const sample_t& sample, clock_type::time_point now) -> clock_type::duration {
+    // Estimates are halved for every this many seconds without observations.
+    const double kHalfLife = 10.0;
+
+    const double age = std::chrono::duration<double>(now - sample.updated).count();
+
+    if(age <= 0.0) {
+        return sample.estimate;
+    }
+
+    return std::chrono::duration_cast<clock_type::duration>(
+        sample.estimate * std::exp2(-age / kHalfLife)
+    );
+}
+
+session_queue_t::session_queue_t(const profile_t& profile):
+    m_profile(profile),
+    m_limit(profile.queue_limit ? profile.queue_limit : kDefaultLimit),
+    m_cursor(profile.priority_weights.size() - 1),
+    m_staged(0),
+    m_size(std::make_shared<std::atomic<size_t>>(0))
+{
+    for(auto it = profile.priority_weights.begin(); it != profile.priority_weights.end(); ++it) {
+        m_levels.emplace_back(new level_t(ring_capacity(m_limit), *it));
     }
 }
+
+session_queue_t::~session_queue_t() {
+    // Empty.
+}
+
+bool
+session_queue_t::push(const value_type& session) {
+    // Reserve the place first, so that concurrent producers can't overshoot the limit.
+    if(m_size->fetch_add(1, std::memory_order_acq_rel) >= m_limit) {
+        m_size->fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+    }
+
+    session->enqueued(m_size);
+
+    auto& ring = m_levels[level_of(session)]->ring;
+
+    // The ring might be full either with the cancelled sessions, which have given their places back
+    // but haven't been staged yet, or because a cell is still being released by a consumer. In the
+    // former case, stage the ring contents unless some consumer is already doing that.
+    while(!ring.push(session)) {
+        std::unique_lock<std::mutex> guard(m_mutex, std::try_to_lock);
+
+        if(guard.owns_lock()) {
+            stage();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    return true;
+}
+
+bool
+session_queue_t::pop(value_type& session) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    stage();
+
+    // Cancelled sessions stay in the queue, and are only dropped once they reach its head.
+    while(take(session)) {
+        session->dequeued();
+
+        if(!session->cancelled()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+session_queue_t::take(value_type& session) {
+    // Find the next level with staged sessions, starting from the one which is being served. Levels
+    // are visited from the highest to the lowest one.
+    for(size_t skipped = 0; skipped < m_levels.size(); ++skipped) {
+        auto& level = *m_levels[m_cursor];
+
+        if(!level.empty()) {
+            break;
+        }
+
+        level.deficit = 0;
+        m_cursor = m_cursor ? m_cursor - 1 : m_levels.size() - 1;
+    }
+
+    auto& level = *m_levels[m_cursor];
+
+    if(level.empty()) {
+        return false;
+    }
+
+    if(level.deficit == 0) {
+        level.deficit = level.weight;
+    }
+
+    if(--level.deficit == 0) {
+        m_cursor = m_cursor ? m_cursor - 1 : m_levels.size() - 1;
+    }
+
+    if(m_profile.deadline_first) {
+        std::pop_heap(level.deadlines.begin(), level.deadlines.end());
+        session = std::move(level.deadlines.back().session);
+        level.deadlines.pop_back();
+        return true;
+    }
+
+    flow_t* flow = level.active.front();
+
+    if(flow->deficit == 0) {
+        flow->deficit = flow->weight;
+    }
+
+    session = std::move(flow->sessions.front());
+    flow->sessions.pop_front();
+
+    if(flow->sessions.empty()) {
+        level.active.pop_front();
+        level.flows.erase(level.flows.find(flow->name));
+    } else if(--flow->deficit == 0) {
+        level.active.pop_front();
+        level.active.push_back(flow);
+    }
+
+    return true;
+}
+
+void
+session_queue_t::shed(const deadline_estimator_t& estimator, std::vector<value_type>& hopeless) {
+    if(!m_profile.deadline_first) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    stage();
+
+    const auto now = api::policy_t::clock_type::now();
+
+    for(auto it = m_levels.begin(); it != m_levels.end(); ++it) {
+        auto& deadlines = (*it)->deadlines;
+
+        while(!deadlines.empty()) {
+            const auto& head = deadlines.front().session;
+
+            if(!head->cancelled() && !estimator.hopeless(head->event, now)) {
+                break;
+            }
+
+            std::pop_heap(deadlines.begin(), deadlines.end());
+
+            auto& session = deadlines.back().session;
+
+            session->dequeued();
+
+            if(!session->cancelled()) {
+                hopeless.push_back(std::move(session));
+            }
+
+            deadlines.pop_back();
+        }
+    }
+}
+
+void
+session_queue_t::stage() {
+    value_type session;
+
+    for(auto it = m_levels.begin(); it != m_levels.end(); ++it) {
+        auto& level = **it;
+
+        while(level.ring.pop(session)) {
+            if(session->cancelled()) {
+                // Its place in the depth has been already given back.
+                continue;
+            }
+
+            if(m_profile.deadline_first) {
+                const auto& policy = session->event.policy;
+
+                deadline_t entry = {
+                    policy.deadline > api::policy_t::clock_type::time_point() ?
+                        policy.deadline
+                      : api::policy_t::clock_type::time_point::max(),
+                    m_staged++,
+                    std::move(session)
+                };
+
+                level.deadlines.push_back(std::move(entry));
+                std::push_heap(level.deadlines.begin(), level.deadlines.end());
+
+                continue;
+            }
+
+            const auto& policy = session->event.policy;
+            const auto& name   = policy.tenant.empty() ? session->event.name : policy.tenant;
+
+            auto lb = level.flows.find(name);
+
+            if(lb == level.flows.end()) {
+                const auto weight = m_profile.flow_weights.find(name);
+
+                flow_t flow = {
+                    name,
+                    weight != m_profile.flow_weights.end() ? weight->second : 1UL,
+                    0,
+                    std::deque<value_type>()
+                };
+
+                lb = level.flows.insert(std::make_pair(name, std::move(flow))).first;
+                level.active.push_back(&lb->second);
+            }
+
+            lb->second.sessions.push_back(std::move(session));
+        }
+    }
+}
+
+auto
+session_queue_t::level_of(const value_type& session) const -> size_t {
+    const auto& policy = session->event.policy;
+    const auto  top    = m_levels.size() - 1;
+
+    return policy.urgent ? top : std::min<size_t>(policy.priority, top);
+}
@@ -20,6 +20,8 @@
 
 #include "cocaine/detail/service/node/session.hpp"
 
+#include "cocaine/detail/service/node/outbox.hpp"
+
 #include "cocaine/rpc/queue.hpp"
 
 #include "cocaine/traits/enum.hpp"
@@ -30,65 +32,25 @@
 using namespace cocaine::engine;
 using namespace cocaine::io;
 
-class session_t::push_action_t:
-    public std::enable_shared_from_this<push_action_t>
-{
-    const encoder_t::message_type message;
-
-    // Keeps the session alive until all the operations are complete.
-    const std::shared_ptr<session_t> session;
-
-public:
-    push_action_t(encoder_t::message_type&& message, const std::shared_ptr<session_t>& session_):
-        message(std::move(message)),
-        session(session_)
-    { }
-
-    void
-    operator()(const std::shared_ptr<writable_stream<protocol_type, encoder_t>>& stream) {
-        stream->write(
-            message,
-            std::bind(&push_action_t::on_write, shared_from_this(), ph::_1)
-        );
-    }
-
-private:
-    void
-    on_write(const std::error_code& ec) {
-        if(ec) {
-            if(ec == asio::error::operation_aborted) {
-                return;
-            }
-
-            session->close();
-        }
-    }
-};
-
 // Temporary adapter to join together `writable_stream` and `io::message_queue`.
 // Guaranteed to live longer than the parent session.
 class session_t::stream_adapter_t:
     public std::enable_shared_from_this<stream_adapter_t>
 {
     std::shared_ptr<session_t> m_session;
-    std::shared_ptr<writable_stream<protocol_type, encoder_t>> m_downstream;
+    std::shared_ptr<outbox_t> m_outbox;
 
 public:
     stream_adapter_t() = default;
-    stream_adapter_t(const std::shared_ptr<session_t>& session,
-                     const std::shared_ptr<writable_stream<protocol_type, encoder_t>>& downstream):
+    stream_adapter_t(const std::shared_ptr<session_t>& session, const std::shared_ptr<outbox_t>& outbox):
         m_session(session),
-        m_downstream(downstream)
+        m_outbox(outbox)
     { }
 
     template<class Event, class... Args>
     void
     send(Args&&... args) {
-        auto push = std::make_shared<push_action_t>(
-            io::encoded<Event>(m_session->id, std::forward<Args>(args)...),
-            m_session
-        );
-        (*push)(m_downstream);
+        m_outbox->send<Event>(m_session, m_session->id, std::forward<Args>(args)...);
     }
 };
 
@@ -97,21 +59,37 @@ session_t::session_t(uint64_t id_, const api::event_t& event_, const api::stream
     event(event_),
     upstream(upstream_),
     m_writer(new synchronized<message_queue<io::rpc_tag, stream_adapter_t>>),
-    m_state(state::open)
+    m_state(state::open),
+    m_cancelled(false),
+    m_cancellable(false)
 {
     // Cache the invocation command right away.
     send<rpc::invoke>(event.name);
 }
 
 void
-session_t::attach(const std::shared_ptr<writable_stream<protocol_type, encoder_t>>& downstream) {
-    m_writer->synchronize()->attach(std::make_shared<stream_adapter_t>(shared_from_this(), downstream));
+session_t::attach(const std::shared_ptr<outbox_t>& outbox, bool cancellable) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_writer) {
+        return;
+    }
+
+    m_writer->synchronize()->attach(std::make_shared<stream_adapter_t>(shared_from_this(), outbox));
+    m_cancellable = cancellable;
+
+    // The session might have been cancelled on its way from the queue to the worker.
+    if(m_cancelled && m_cancellable) {
+        m_writer->synchronize()->append<rpc::cancel>();
+    }
 }
 
 void
 session_t::detach() {
     close();
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     // Disable the session.
     m_writer.reset();
 }
@@ -127,6 +105,49 @@ session_t::close() {
     }
 }
 
+void
+session_t::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_cancelled.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    if(m_depth) {
+        m_depth->fetch_sub(1, std::memory_order_acq_rel);
+        m_depth.reset();
+    }
+
+    // The client might have already closed its side of the stream, so the state isn't checked. If
+    // the session hasn't been attached yet, it's either skipped in the queue or the message is sent
+    // on attachment.
+    if(m_writer && m_cancellable) {
+        m_writer->synchronize()->append<rpc::cancel>();
+    }
+}
+
+void
+session_t::enqueued(const std::shared_ptr<std::atomic<size_t>>& depth) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_cancelled) {
+        // The place has been reserved for a session which is already gone.
+        depth->fetch_sub(1, std::memory_order_acq_rel);
+    } else {
+        m_depth = depth;
+    }
+}
+
+void
+session_t::dequeued() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_depth) {
+        m_depth->fetch_sub(1, std::memory_order_acq_rel);
+        m_depth.reset();
+    }
+}
+
 session_t::downstream_t::downstream_t(const std::shared_ptr<session_t>& parent_):
     parent(parent_)
 { }
@@ -149,3 +170,8 @@ void
 session_t::downstream_t::close() {
     parent->close();
 }
+
+void
+session_t::downstream_t::cancel() {
+    parent->cancel();
+}
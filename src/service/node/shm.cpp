@@ -0,0 +1,256 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/service/node/shm.hpp"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if !defined(MFD_CLOEXEC)
+    #define MFD_CLOEXEC 0x0001U
+#endif
+
+#if !defined(F_GET_SEALS)
+    #define F_GET_SEALS   1034
+    #define F_SEAL_SHRINK 0x0002
+    #define F_SEAL_WRITE  0x0008
+#endif
+
+using namespace cocaine;
+using namespace cocaine::engine;
+
+namespace {
+
+int
+memfd_create(const std::string& name) {
+#if defined(SYS_memfd_create)
+    return ::syscall(SYS_memfd_create, name.c_str(), MFD_CLOEXEC);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+} // namespace
+
+// Shared memory
+
+shared_memory_t::shared_memory_t(const std::string& name, size_t size):
+    m_fd(-1),
+    m_data(nullptr),
+    m_size(size)
+{
+    if((m_fd = memfd_create(name)) == -1) {
+        throw std::system_error(errno, std::system_category(), "unable to create shared memory");
+    }
+
+    void* data = MAP_FAILED;
+
+    // NOTE: Fresh memfd pages are zeroed, which is exactly what the ring headers need.
+    if(::ftruncate(m_fd, m_size) != 0 ||
+       (data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)) == MAP_FAILED)
+    {
+        const int error = errno;
+        ::close(m_fd);
+        throw std::system_error(error, std::system_category(), "unable to map shared memory");
+    }
+
+    m_data = static_cast<char*>(data);
+}
+
+shared_memory_t::~shared_memory_t() {
+    ::munmap(m_data, m_size);
+    ::close(m_fd);
+}
+
+// Shared mapping
+
+shared_mapping_t::shared_mapping_t(int fd, size_t size):
+    m_fd(fd),
+    m_data(nullptr),
+    m_size(size)
+{
+    // NOTE: Without the seals, the worker could shrink the memfd after the size check below, or keep
+    // modifying it while the chunk is being encoded, and the mapping would fault with a SIGBUS.
+    const int seals = ::fcntl(m_fd, F_GET_SEALS);
+
+    if(seals == -1 || (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE)) {
+        ::close(m_fd);
+        throw std::system_error(EPERM, std::system_category(), "shared memory is not sealed");
+    }
+
+    struct stat info;
+
+    if(::fstat(m_fd, &info) != 0) {
+        const int error = errno;
+        ::close(m_fd);
+        throw std::system_error(error, std::system_category(), "unable to map shared memory");
+    }
+
+    if(static_cast<uint64_t>(info.st_size) < m_size) {
+        ::close(m_fd);
+        throw std::system_error(EINVAL, std::system_category(), "shared memory is truncated");
+    }
+
+    if(m_size == 0) {
+        return;
+    }
+
+    void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+
+    if(data == MAP_FAILED) {
+        const int error = errno;
+        ::close(m_fd);
+        throw std::system_error(error, std::system_category(), "unable to map shared memory");
+    }
+
+    m_data = static_cast<char*>(data);
+}
+
+shared_mapping_t::~shared_mapping_t() {
+    if(m_data) {
+        ::munmap(m_data, m_size);
+    }
+
+    ::close(m_fd);
+}
+
+// Shared ring
+
+shared_ring_t::shared_ring_t(char* memory, size_t capacity):
+    m_header(reinterpret_cast<header_t*>(memory)),
+    m_data(memory + sizeof(header_t)),
+    m_capacity(capacity)
+{
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+        "shared ring positions must be plain 64-bit integers");
+
+    BOOST_ASSERT(capacity && (capacity & (capacity - 1)) == 0);
+}
+
+bool
+shared_ring_t::empty() const {
+    return m_header->head.load(std::memory_order_relaxed) ==
+           m_header->tail.load(std::memory_order_acquire);
+}
+
+size_t
+shared_ring_t::available() const {
+    return m_capacity - (m_header->head.load(std::memory_order_relaxed) -
+                         m_header->tail.load(std::memory_order_acquire));
+}
+
+bool
+shared_ring_t::push(const char* data, size_t size, bool& doorbell) {
+    if(kFrameHeader + size > available()) {
+        return false;
+    }
+
+    const uint64_t head = m_header->head.load(std::memory_order_relaxed);
+    const uint32_t frame = static_cast<uint32_t>(size);
+
+    write(head, reinterpret_cast<const char*>(&frame), kFrameHeader);
+    write(head + kFrameHeader, data, size);
+
+    m_header->head.store(head + kFrameHeader + size, std::memory_order_seq_cst);
+
+    // The consumer might have already drained the ring and gone to sleep, see consume().
+    if(m_header->tail.load(std::memory_order_seq_cst) == head) {
+        doorbell = true;
+    }
+
+    return true;
+}
+
+bool
+shared_ring_t::wait(size_t size) {
+    m_header->waiting.store(1, std::memory_order_seq_cst);
+
+    return kFrameHeader + size > available();
+}
+
+void
+shared_ring_t::read(uint64_t position, char* target, size_t size) const {
+    const size_t offset = position & (m_capacity - 1);
+    const size_t chunk  = std::min(size, m_capacity - offset);
+
+    std::memcpy(target, m_data + offset, chunk);
+    std::memcpy(target + chunk, m_data, size - chunk);
+}
+
+void
+shared_ring_t::write(uint64_t position, const char* source, size_t size) {
+    const size_t offset = position & (m_capacity - 1);
+    const size_t chunk  = std::min(size, m_capacity - offset);
+
+    std::memcpy(m_data + offset, source, chunk);
+    std::memcpy(m_data, source + chunk, size - chunk);
+}
+
+// Ring transport
+
+ring_transport_t::ring_transport_t(const std::string& name, size_t capacity):
+    m_memory(name, 2 * shared_ring_t::footprint(capacity)),
+    m_tx(m_memory.data(), capacity),
+    m_rx(m_memory.data() + shared_ring_t::footprint(capacity), capacity)
+{ }
+
+// Descriptor passing
+
+void
+engine::send_descriptor(int socket, const char* data, size_t size, int fd) {
+    struct iovec iov;
+
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len  = size;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    std::memset(control, 0, sizeof(control));
+
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+
+    message.msg_iov        = &iov;
+    message.msg_iovlen     = 1;
+    message.msg_control    = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type  = SCM_RIGHTS;
+    header->cmsg_len   = CMSG_LEN(sizeof(int));
+
+    std::memcpy(CMSG_DATA(header), &fd, sizeof(int));
+
+    const ssize_t sent = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+
+    if(sent == -1) {
+        throw std::system_error(errno, std::system_category(), "unable to send descriptor");
+    } else if(static_cast<size_t>(sent) != size) {
+        throw std::system_error(EAGAIN, std::system_category(), "unable to send descriptor");
+    }
+}
@@ -24,9 +24,13 @@
 
 #include "cocaine/detail/service/node/engine.hpp"
 #include "cocaine/detail/service/node/event.hpp"
+#include "cocaine/detail/service/node/index.hpp"
 #include "cocaine/detail/service/node/manifest.hpp"
+#include "cocaine/detail/service/node/outbox.hpp"
 #include "cocaine/detail/service/node/profile.hpp"
+#include "cocaine/detail/service/node/queue.hpp"
 #include "cocaine/detail/service/node/session.hpp"
+#include "cocaine/detail/service/node/shm.hpp"
 #include "cocaine/detail/service/node/stream.hpp"
 
 #include "cocaine/idl/rpc.hpp"
@@ -38,6 +42,7 @@
 #include "cocaine/traits/enum.hpp"
 #include "cocaine/traits/literal.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 #include <boost/circular_buffer.hpp>
@@ -52,6 +57,28 @@ using namespace cocaine;
 using namespace cocaine::engine;
 using namespace cocaine::io;
 
+namespace {
+
+// Orders the sessions by their deadlines, the ones without a deadline go last.
+struct by_deadline {
+    typedef api::policy_t::clock_type clock_type;
+
+    static
+    clock_type::time_point
+    deadline(const std::shared_ptr<session_t>& session) {
+        const auto& policy = session->event.policy;
+
+        return policy.deadline > clock_type::time_point() ? policy.deadline : clock_type::time_point::max();
+    }
+
+    bool
+    operator()(const std::shared_ptr<session_t>& lhs, const std::shared_ptr<session_t>& rhs) const {
+        return deadline(lhs) < deadline(rhs);
+    }
+};
+
+} // namespace
+
 struct slave_t::output_t  {
     std::array<char, 4096> buffer;
     boost::circular_buffer<std::string> lines;
@@ -76,26 +103,36 @@ struct slave_t::output_t  {
 slave_t::slave_t(const std::string& id,
                  const manifest_t& manifest,
                  const profile_t& profile,
+                 deadline_estimator_t& estimator,
+                 load_index_t& index,
                  context_t& context,
                  rebalance_type rebalance,
                  suicide_type suicide,
+                 retire_type retire,
                  asio::io_service& asio) :
     m_context(context),
     m_log(context.log(manifest.name)),
     m_asio(asio),
     m_manifest(manifest),
     m_profile(profile),
+    m_estimator(estimator),
+    m_index(index),
     m_id(id),
     m_rebalance(rebalance),
     m_suicide(suicide),
+    m_retire(retire),
     m_state(states::unknown),
+    m_activated(false),
 #ifdef COCAINE_HAS_FEATURE_STEADY_CLOCK
     m_birthstamp(std::chrono::steady_clock::now()),
 #else
     m_birthstamp(std::chrono::monotonic_clock::now()),
 #endif
     m_heartbeat_timer(asio),
-    m_idle_timer(asio)
+    m_idle_timer(asio),
+    m_cancellation(false),
+    m_deferred(false),
+    m_assigning(0)
 {
     asio.post(std::bind(&slave_t::activate, this));
 }
@@ -104,22 +141,40 @@ slave_t::~slave_t() {
     COCAINE_LOG_DEBUG(m_log, "slave %s is terminating", m_id);
     BOOST_ASSERT(m_state == states::inactive);
     BOOST_ASSERT(m_sessions.empty() && m_queue.empty());
+
+    m_index.remove(this);
 }
 
 void
-slave_t::bind(const std::shared_ptr<io::channel<protocol_type>>& channel) {
+slave_t::bind(const std::shared_ptr<io::channel<protocol_type>>& channel,
+              const std::shared_ptr<ring_transport_t>& rings,
+              bool cancellation)
+{
     BOOST_ASSERT(m_state == states::unknown);
     BOOST_ASSERT(!m_channel);
 
     m_channel = channel;
-    m_channel->reader->read(m_message, std::bind(&slave_t::on_read, shared_from_this(), ph::_1));
+    m_rings = rings;
+    m_cancellation = cancellation;
+    m_outbox = std::make_shared<outbox_t>(m_asio, m_channel->writer, m_rings);
+    m_channel->reader->read(m_messages, std::bind(&slave_t::on_read, shared_from_this(), ph::_1));
 }
 
 void
 slave_t::assign(const std::shared_ptr<session_t>& session) {
+    // Account for the session right away, so that the engine won't overcommit this slave while the
+    // assignment is in flight.
+    m_assigning++;
+    reindex();
+
     m_asio.post(std::bind(&slave_t::do_assign, shared_from_this(), session));
 }
 
+void
+slave_t::reindex() {
+    m_index.update(this);
+}
+
 void
 slave_t::stop() {
     m_asio.post(std::bind(&slave_t::do_stop, shared_from_this()));
@@ -129,6 +184,7 @@ void
 slave_t::do_stop() {
     BOOST_ASSERT(m_state == states::active);
     m_state = states::inactive;
+    reindex();
     m_channel->writer->write(
         encoded<rpc::terminate>(1, rpc::terminate::normal, "the engine is shutting down"),
         std::bind(&slave_t::on_write, shared_from_this(), ph::_1)
@@ -140,7 +196,24 @@ slave_t::do_assign(std::shared_ptr<session_t> session) {
     BOOST_ASSERT(m_state != states::inactive);
 
     typedef api::policy_t::clock_type clock_type;
-    if(session->event.policy.deadline > clock_type::time_point() && session->event.policy.deadline <= clock_type::now()) {
+
+    const auto now = clock_type::now();
+
+    m_assigning--;
+    reindex();
+
+    if(session->cancelled()) {
+        COCAINE_LOG_DEBUG(m_log, "session %d has been cancelled, dropping", session->id);
+        return;
+    }
+
+    if(m_profile.deadline_first) {
+        if(m_estimator.hopeless(session->event, now)) {
+            COCAINE_LOG_DEBUG(m_log, "session %d won't make its deadline, dropping", session->id);
+            session->upstream->error(error::deadline_error, "the session won't make its deadline");
+            return;
+        }
+    } else if(session->event.policy.deadline > clock_type::time_point() && session->event.policy.deadline <= now) {
         COCAINE_LOG_DEBUG(m_log, "session %d has expired, dropping", session->id);
         session->upstream->error(error::deadline_error, "the session has expired in the queue");
         return;
@@ -148,19 +221,31 @@ slave_t::do_assign(std::shared_ptr<session_t> session) {
     m_idle_timer.cancel();
 
     if(m_sessions.size() >= m_profile.concurrency || m_state == states::unknown) {
-        m_queue.push_back(session);
+        if(m_profile.deadline_first) {
+            m_queue.insert(std::upper_bound(m_queue.begin(), m_queue.end(), session, by_deadline()), session);
+        } else {
+            m_queue.push_back(session);
+        }
+        reindex();
         return;
     }
 
     BOOST_ASSERT(m_state == states::active);
     m_sessions.insert(std::make_pair(session->id, session));
+    reindex();
+
+    session->started = now;
 
     COCAINE_LOG_DEBUG(m_log, "slave %s has started processing %d session", m_id, session->id);
-    session->attach(m_channel->writer);
+    session->attach(m_outbox, m_cancellation);
 }
 
 void
 slave_t::activate() {
+    // Starting slaves are spare ones. The index is owned by the engine thread, so they're indexed
+    // here rather than on construction, which might happen on a client's thread.
+    reindex();
+
     COCAINE_LOG_DEBUG(m_log, "slave %s is activating, timeout: %.02f seconds",
         m_id,
         m_profile.startup_timeout
@@ -216,10 +301,21 @@ slave_t::on_read(const std::error_code& ec) {
         }
         on_failure(ec);
     } else {
-        on_message(m_message);
+        // Process the whole batch of messages in one go before re-arming the read operation.
+        for(auto it = m_messages.begin(); it != m_messages.end(); ++it) {
+            receive(*it);
+
+            if(m_state == states::inactive) {
+                break;
+            }
+        }
+
+        if(m_channel) {
+            m_channel->reader->recycle(m_messages);
+        }
 
         if(m_state != states::inactive) {
-            m_channel->reader->read(m_message, std::bind(&slave_t::on_read, shared_from_this(), ph::_1));
+            m_channel->reader->read(m_messages, std::bind(&slave_t::on_read, shared_from_this(), ph::_1));
         }
     }
 }
@@ -294,6 +390,10 @@ slave_t::process(const io::decoder_t::message_type& message) {
         break;
     }
     case event_traits<rpc::chunk>::id: {
+        if(splice(message)) {
+            break;
+        }
+
         std::string chunk;
         io::type_traits<
             typename io::event_traits<rpc::chunk>::argument_type
@@ -301,7 +401,22 @@ slave_t::process(const io::decoder_t::message_type& message) {
         on_chunk(message.span(), chunk);
         break;
     }
+    case event_traits<rpc::blob>::id: {
+        uint64_t size;
+        io::type_traits<
+            typename io::event_traits<rpc::blob>::argument_type
+        >::unpack(message.args(), size);
+        on_blob(message.span(), size);
+        break;
+    }
+    case event_traits<rpc::doorbell>::id:
+        on_doorbell();
+        break;
     case event_traits<rpc::error>::id: {
+        if(splice(message)) {
+            break;
+        }
+
         int code;
         std::string reason;
         io::type_traits<
@@ -315,6 +430,46 @@ slave_t::process(const io::decoder_t::message_type& message) {
         break;
     default:
         COCAINE_LOG_WARNING(m_log, "slave %s dropped unknown type %d message in session %d", m_id, message.type(), message.span());
+        return;
+    }
+
+}
+
+void
+slave_t::receive(const io::decoder_t::message_type& message) {
+    bool ordered = false;
+
+    switch(message.type()) {
+    case event_traits<rpc::chunk>::id:
+    case event_traits<rpc::blob>::id:
+    case event_traits<rpc::error>::id:
+    case event_traits<rpc::choke>::id:
+        ordered = static_cast<bool>(m_rings);
+    }
+
+    if(!ordered) {
+        on_message(message);
+        return;
+    }
+
+    // The session messages which went through the socket are announced by a marker frame in the
+    // incoming ring, so everything ahead of the marker has to be handled first. The doorbell for
+    // those frames might not have been processed yet.
+    if(!m_deferred) {
+        drain();
+    }
+
+    if(m_state == states::inactive) {
+        return;
+    }
+
+    on_message(message);
+
+    if(m_deferred && m_state != states::inactive) {
+        // The message deferred by the marker frame has been handled, so the incoming ring can be
+        // consumed further.
+        m_deferred = false;
+        drain();
     }
 }
 
@@ -370,6 +525,8 @@ slave_t::on_ping() {
         COCAINE_LOG_DEBUG(m_log, "slave %s became active in %.03f seconds", m_id, uptime.count());
 
         m_state = states::active;
+        m_activated = true;
+        reindex();
 
         if(m_profile.idle_timeout) {
             // Start the idle timer, which will kill the slave when it's not used.
@@ -408,6 +565,53 @@ slave_t::on_chunk(uint64_t session_id, const std::string& chunk) {
         it->second->upstream->write(chunk.data(), chunk.size());
     } catch (const cocaine::error_t& err) {
         COCAINE_LOG_WARNING(m_log, "slave %s is unable to send write event to the upstream: %s", m_id, err.what());
+
+        // Nobody is going to read the rest of the results.
+        it->second->cancel();
+    }
+}
+
+void
+slave_t::on_blob(uint64_t session_id, uint64_t size) {
+    BOOST_ASSERT(m_state == states::active);
+
+    COCAINE_LOG_DEBUG(m_log, "slave %s received blob in session %d", m_id, session_id)(
+        "size", size
+    );
+
+    const int fd = m_channel->reader->descriptor();
+
+    if(fd == -1) {
+        COCAINE_LOG_ERROR(m_log, "slave %s has sent a blob without a memfd in session %d", m_id, session_id);
+        terminate(rpc::terminate::code::normal, "slave has sent a blob without a memfd");
+        return;
+    }
+
+    std::unique_ptr<shared_mapping_t> blob;
+
+    try {
+        blob = std::make_unique<shared_mapping_t>(fd, size);
+    } catch(const std::system_error& e) {
+        COCAINE_LOG_ERROR(m_log, "slave %s has sent a broken blob in session %d: [%d] %s", m_id,
+            session_id, e.code().value(), e.code().message());
+        terminate(rpc::terminate::code::normal, "slave has sent a broken blob");
+        return;
+    }
+
+    auto it = m_sessions.find(session_id);
+    if(it == m_sessions.end()) {
+        COCAINE_LOG_WARNING(m_log, "slave %s received orphan session %d blob", m_id, session_id);
+        return;
+    }
+
+    try {
+        // The chunk is encoded right from the mapping, without going through the socket.
+        it->second->upstream->write(blob->data(), blob->size());
+    } catch (const cocaine::error_t& err) {
+        COCAINE_LOG_WARNING(m_log, "slave %s is unable to send write event to the upstream: %s", m_id, err.what());
+
+        // Nobody is going to read the rest of the results.
+        it->second->cancel();
     }
 }
 
@@ -430,6 +634,7 @@ slave_t::on_error(uint64_t session_id, int code, const std::string& reason) {
         it->second->upstream->error(code, reason);
     } catch (const cocaine::error_t& err) {
         COCAINE_LOG_WARNING(m_log, "slave %s is unable to send error event to the upstream: %s", m_id, err.what());
+        it->second->cancel();
     }
 }
 
@@ -447,6 +652,9 @@ slave_t::on_choke(uint64_t session_id) {
 
     auto session = std::move(it->second);
     m_sessions.erase(it);
+    reindex();
+
+    m_estimator.observe(session->event.name, api::policy_t::clock_type::now() - session->started);
 
     try {
         session->upstream->close();
@@ -461,6 +669,109 @@ slave_t::on_choke(uint64_t session_id) {
     pump();
 }
 
+bool
+slave_t::splice(const io::decoder_t::message_type& message) {
+    BOOST_ASSERT(m_state == states::active);
+
+    const auto packed = message.packed_args();
+
+    if(!packed.blob) {
+        return false;
+    }
+
+    // The unpacker has already parsed the arguments, so checking them against the protocol is
+    // cheap, unlike copying the payload out and packing it back again.
+    const auto& args = message.args().via.array;
+
+    switch(message.type()) {
+    case event_traits<rpc::chunk>::id:
+        if(args.size != 1 || args.ptr[0].type != msgpack::type::RAW) {
+            return false;
+        }
+        break;
+    case event_traits<rpc::error>::id:
+        if(args.size != 2 || args.ptr[1].type != msgpack::type::RAW ||
+          (args.ptr[0].type != msgpack::type::POSITIVE_INTEGER &&
+           args.ptr[0].type != msgpack::type::NEGATIVE_INTEGER))
+        {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    auto it = m_sessions.find(message.span());
+    if(it == m_sessions.end()) {
+        // Orphans are reported by the regular handlers.
+        return false;
+    }
+
+    COCAINE_LOG_DEBUG(m_log, "slave %s is splicing type %d message in session %d", m_id, message.type(),
+        message.span()
+    )("size", packed.size);
+
+    try {
+        if(message.type() == event_traits<rpc::chunk>::id) {
+            return it->second->upstream->splice_chunk(packed.blob, packed.size);
+        } else {
+            return it->second->upstream->splice_error(packed.blob, packed.size);
+        }
+    } catch (const cocaine::error_t& err) {
+        COCAINE_LOG_WARNING(m_log, "slave %s is unable to splice the message to the upstream: %s", m_id, err.what());
+        it->second->cancel();
+    }
+
+    return true;
+}
+
+void
+slave_t::on_doorbell() {
+    if(!m_rings) {
+        COCAINE_LOG_WARNING(m_log, "slave %s rang the doorbell without shared rings", m_id);
+        return;
+    }
+
+    // The worker might have freed some space in the outgoing ring.
+    m_outbox->flush();
+
+    if(!m_deferred) {
+        drain();
+    }
+}
+
+void
+slave_t::drain() {
+    bool doorbell;
+
+    try {
+        doorbell = m_rings->rx().consume([this](const char* data, size_t size) -> bool {
+            if(size == 0) {
+                m_deferred = true;
+                return false;
+            }
+
+            std::error_code ec;
+
+            if(m_decoder.decode(data, size, m_frame, ec) != size || ec) {
+                throw cocaine::error_t("slave ring frame is malformed");
+            }
+
+            on_message(m_frame);
+
+            return m_state != states::inactive;
+        });
+    } catch(const cocaine::error_t& e) {
+        COCAINE_LOG_ERROR(m_log, "slave %s has corrupted its shared ring: %s", m_id, e.what());
+        terminate(rpc::terminate::code::normal, "slave has corrupted its shared ring");
+        return;
+    }
+
+    if(doorbell && m_state != states::inactive) {
+        m_outbox->notify();
+    }
+}
+
 void
 slave_t::on_timeout(const std::error_code& ec) {
     if(ec == asio::error::operation_aborted) {
@@ -493,8 +804,16 @@ slave_t::on_idle(const std::error_code& ec) {
     BOOST_ASSERT(m_state == states::active);
     BOOST_ASSERT(m_sessions.empty() && m_queue.empty());
 
+    if(!m_retire()) {
+        // Keep the slave warm, but check again later, as the pool might have grown meanwhile.
+        m_idle_timer.expires_from_now(boost::posix_time::seconds(m_profile.idle_timeout));
+        m_idle_timer.async_wait(std::bind(&slave_t::on_idle, shared_from_this(), ph::_1));
+        return;
+    }
+
     COCAINE_LOG_DEBUG(m_log, "slave %s is idle, deactivating", m_id);
     m_state = states::inactive;
+    reindex();
 
     m_channel->writer->write(
         encoded<rpc::terminate>(1, rpc::terminate::normal, "slave is idle"),
@@ -504,7 +823,7 @@ slave_t::on_idle(const std::error_code& ec) {
 
 void
 slave_t::pump() {
-    session_queue_t::value_type session;
+    std::shared_ptr<session_t> session;
 
     while(!m_queue.empty()) {
         if(m_queue.empty() || m_sessions.size() >= m_profile.concurrency) {
@@ -562,6 +881,7 @@ void
 slave_t::terminate(int code, const std::string& reason) {
     COCAINE_LOG_DEBUG(m_log, "terminating %s slave: [%d] %d", m_id, code, reason);
     m_state = states::inactive;
+    reindex();
 
     if(!m_sessions.empty()) {
         COCAINE_LOG_WARNING(m_log, "slave %s dropping %llu sessions", m_id, m_sessions.size());
@@ -22,6 +22,8 @@
 
 #include "cocaine/api/storage.hpp"
 
+#include "cocaine/context.hpp"
+
 #include "cocaine/dynamic/dynamic.hpp"
 
 using namespace cocaine::io;
@@ -33,12 +35,32 @@ storage_t::storage_t(context_t& context, asio::io_service& asio, const std::stri
 {
     const auto storage = api::storage(context, args.as_object().at("backend", "core").as_string());
 
+    const auto workers = args.as_object().at("workers", 0u).as_uint();
+    const auto limit   = args.as_object().at("queue-limit", 1024u).as_uint();
+
     using namespace std::placeholders;
 
-    on<storage::read>(std::bind(&api::storage_t::read, storage, _1, _2));
-    on<storage::write>(std::bind(&api::storage_t::write, storage, _1, _2, _3, _4));
-    on<storage::remove>(std::bind(&api::storage_t::remove, storage, _1, _2));
-    on<storage::find>(std::bind(&api::storage_t::find, storage, _1, _2));
+    // The blob is borrowed right from the incoming frame, so it's never copied unless the backend
+    // needs an owning copy, or the invocation is offloaded.
+    const auto write = &api::storage_t::write_view;
+
+    if(!workers) {
+        on<storage::read>(std::bind(&api::storage_t::read, storage, _1, _2));
+        on<storage::write>(std::bind(write, storage, _1, _2, _3, _4));
+        on<storage::remove>(std::bind(&api::storage_t::remove, storage, _1, _2));
+        on<storage::find>(std::bind(&api::storage_t::find, storage, _1, _2));
+
+        return;
+    }
+
+    // Storage backends do blocking I/O, so run them on a separate bounded pool to never stall the
+    // execution units.
+    m_executor = std::make_shared<executor_t>(context.log(name), name, workers, limit);
+
+    on<storage::read>(std::bind(&api::storage_t::read, storage, _1, _2), m_executor);
+    on<storage::write>(std::bind(write, storage, _1, _2, _3, _4), m_executor);
+    on<storage::remove>(std::bind(&api::storage_t::remove, storage, _1, _2), m_executor);
+    on<storage::find>(std::bind(&api::storage_t::find, storage, _1, _2), m_executor);
 }
 
 const basic_dispatch_t&
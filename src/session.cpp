@@ -27,6 +27,10 @@
 #include "cocaine/rpc/dispatch.hpp"
 #include "cocaine/rpc/upstream.hpp"
 
+#include <asio/local/stream_protocol.hpp>
+
+#include <atomic>
+
 using namespace asio;
 using namespace asio::ip;
 
@@ -35,10 +39,121 @@ using namespace cocaine::io;
 
 // Session internals
 
+// Protocol-agnostic interface to the underlying channel, so that the same session machinery could
+// serve both TCP and local connections.
+
+class session_t::transport_t {
+public:
+    typedef std::vector<decoder_t::message_type> batch_type;
+    typedef std::function<void(const std::error_code&)> handler_type;
+
+    virtual
+   ~transport_t() {
+        // Empty.
+    }
+
+    virtual
+    auto
+    get_io_service() -> io_service& = 0;
+
+    virtual
+    void
+    read(batch_type& batch, handler_type handle) = 0;
+
+    virtual
+    void
+    recycle(batch_type& batch) = 0;
+
+    virtual
+    void
+    bind(handler_type handle) = 0;
+
+    virtual
+    void
+    write(const encoder_t::message_type& message) = 0;
+
+    virtual
+    auto
+    pressure() const -> size_t = 0;
+
+    virtual
+    auto
+    remote_endpoint() const -> tcp::endpoint = 0;
+};
+
+namespace {
+
+auto
+peer_of(const tcp::socket& socket) -> tcp::endpoint {
+    return socket.remote_endpoint();
+}
+
+auto
+peer_of(const local::stream_protocol::socket&) -> tcp::endpoint {
+    return tcp::endpoint();
+}
+
+} // namespace
+
+template<class Protocol>
+class session_t::basic_transport_t:
+    public transport_t
+{
+    const std::unique_ptr<channel<Protocol>> m_channel;
+
+public:
+    explicit
+    basic_transport_t(std::unique_ptr<channel<Protocol>> channel_):
+        m_channel(std::move(channel_))
+    { }
+
+    virtual
+    auto
+    get_io_service() -> io_service& {
+        return m_channel->socket->get_io_service();
+    }
+
+    virtual
+    void
+    read(batch_type& batch, handler_type handle) {
+        m_channel->reader->read(batch, std::move(handle));
+    }
+
+    virtual
+    void
+    recycle(batch_type& batch) {
+        m_channel->reader->recycle(batch);
+    }
+
+    virtual
+    void
+    bind(handler_type handle) {
+        m_channel->writer->bind(std::move(handle));
+    }
+
+    virtual
+    void
+    write(const encoder_t::message_type& message) {
+        m_channel->writer->write(message);
+    }
+
+    virtual
+    auto
+    pressure() const -> size_t {
+        return m_channel->reader->pressure() + m_channel->writer->pressure();
+    }
+
+    virtual
+    auto
+    remote_endpoint() const -> tcp::endpoint {
+        return peer_of(*m_channel->socket);
+    }
+};
+
 class session_t::pull_action_t:
     public std::enable_shared_from_this<pull_action_t>
 {
-    decoder_t::message_type message;
+    transport_t::batch_type messages;
 
     // Keeps the session alive until all the operations are complete.
     const std::shared_ptr<session_t> session;
@@ -49,7 +164,7 @@ public:
     { }
 
     void
-    operator()(const std::shared_ptr<channel<tcp>> ptr);
+    operator()(const std::shared_ptr<transport_t> ptr);
 
 private:
     void
@@ -57,8 +172,8 @@ private:
 };
 
 void
-session_t::pull_action_t::operator()(const std::shared_ptr<channel<tcp>> ptr) {
-    ptr->reader->read(message, std::bind(&pull_action_t::finalize,
+session_t::pull_action_t::operator()(const std::shared_ptr<transport_t> ptr) {
+    ptr->read(messages, std::bind(&pull_action_t::finalize,
         shared_from_this(),
         std::placeholders::_1
     ));
@@ -76,13 +191,21 @@ session_t::pull_action_t::finalize(const std::error_code& ec) {
         return session->detach(ec);
     }
 
+    std::shared_ptr<transport_t> ptr;
+
+    // Handle the whole batch of messages in one go before re-arming the read operation.
+    for(auto it = messages.begin(); it != messages.end(); ++it) {
 #if defined(__clang__)
-    if(const auto ptr = std::atomic_load(&session->transport)) {
+        if(!(ptr = std::atomic_load(&session->transport))) {
 #else
-    if(const auto ptr = *session->transport.synchronize()) {
+        if(!(ptr = *session->transport.synchronize())) {
 #endif
+            COCAINE_LOG_DEBUG(session->log, "ignoring invocation due to detached session");
+            return;
+        }
+
         try {
-            session->handle(message);
+            session->handle(*it);
         } catch(const std::exception& e) {
             COCAINE_LOG_ERROR(session->log, "uncaught invocation exception - %s", e.what());
 
@@ -90,55 +213,40 @@ session_t::pull_action_t::finalize(const std::error_code& ec) {
             // exceptions. In such case, the client is disconnected to prevent any further damage.
             return session->detach(error::uncaught_error);
         }
+    }
 
-        operator()(std::move(ptr));
-    } else {
-        COCAINE_LOG_DEBUG(session->log, "ignoring invocation due to detached session");
+    if(!ptr) {
+        return;
+    }
+
+    // All the message arguments are unpacked by now, so the frame arenas can be reused.
+    ptr->recycle(messages);
+
+    if(session->congested()) {
+        // Stop reading from the peer until the outgoing backlog drains, see session_t::resume().
+        return session->pause(shared_from_this());
     }
+
+    operator()(std::move(ptr));
 }
 
-class session_t::push_action_t:
-    public enable_shared_from_this<push_action_t>
-{
-    const encoder_t::message_type message;
+// NOTE: Outgoing messages are owned by the session, so the only thing the writer needs to know is
+// how to notify the session about completions. Holding a weak reference here avoids a cycle through
+// the transport.
 
-    // Keeps the session alive until all the operations are complete.
-    const std::shared_ptr<session_t> session;
+class session_t::write_handler_t {
+    const std::weak_ptr<session_t> session;
 
 public:
-    push_action_t(encoder_t::message_type&& message, const std::shared_ptr<session_t>& session_):
-        message(std::move(message)),
+    write_handler_t(const std::shared_ptr<session_t>& session_):
         session(session_)
     { }
 
     void
-    operator()(const std::shared_ptr<channel<tcp>> ptr);
-
-private:
-    void
-    finalize(const std::error_code& ec);
-};
-
-void
-session_t::push_action_t::operator()(const std::shared_ptr<channel<tcp>> ptr) {
-    ptr->writer->write(message, std::bind(&push_action_t::finalize,
-        shared_from_this(),
-        std::placeholders::_1
-    ));
-}
-
-void
-session_t::push_action_t::finalize(const std::error_code& ec) {
-    if(ec.value() == 0) return;
-
-    if(ec != asio::error::eof) {
-        COCAINE_LOG_ERROR(session->log, "client disconnected: [%d] %s", ec.value(), ec.message());
-    } else {
-        COCAINE_LOG_DEBUG(session->log, "client disconnected");
+    operator()(const std::error_code& ec) const {
+        if(const auto ptr = session.lock()) ptr->on_write(ec);
     }
-
-    return session->detach(ec);
-}
+};
 
 class session_t::channel_t
 {
@@ -152,43 +260,356 @@ public:
     upstream_ptr_t upstream;
 };
 
+// Open-addressed table of virtual channels. Channel ids grow monotonically, so they're used as their
+// own hashes. Lookups are lock-free, but only allowed on the execution unit thread, while all the
+// other operations must be synchronized externally. Removed channels and replaced slot arrays are
+// retired, since a concurrent lookup might still use them, and are reclaimed on the execution unit
+// thread later.
+
+class session_t::channel_table_t {
+    COCAINE_DECLARE_NONCOPYABLE(channel_table_t)
+
+    static const size_t kInitialCapacity = 16;
+
+    struct slot_t {
+        // Zero key marks an empty slot, since channel ids start from one. A slot with a key, but
+        // without a channel is a tombstone. Channel ids are never reused, so tombstones can be safely
+        // taken over by new channels.
+        std::atomic<uint64_t> key;
+        std::atomic<channel_t*> value;
+    };
+
+    struct array_t {
+        explicit
+        array_t(size_t capacity_):
+            capacity(capacity_),
+            slots(new slot_t[capacity_])
+        {
+            for(size_t i = 0; i < capacity; ++i) {
+                slots[i].key.store(0, std::memory_order_relaxed);
+                slots[i].value.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        const size_t capacity;
+        const std::unique_ptr<slot_t[]> slots;
+    };
+
+public:
+    struct garbage_t {
+        std::vector<std::unique_ptr<channel_t>> channels;
+        std::vector<std::unique_ptr<array_t>> arrays;
+    };
+
+private:
+    std::atomic<array_t*> m_array;
+
+    // Number of channels and of used slots, including tombstones.
+    size_t m_size;
+    size_t m_used;
+
+    garbage_t m_garbage;
+    std::atomic<bool> m_retired;
+
+public:
+    channel_table_t():
+        m_array(new array_t(kInitialCapacity)),
+        m_size(0),
+        m_used(0),
+        m_retired(false)
+    { }
+
+   ~channel_table_t() {
+        const std::unique_ptr<array_t> array(m_array.load());
+
+        for(size_t i = 0; i < array->capacity; ++i) {
+            delete array->slots[i].value.load();
+        }
+    }
+
+    // Lock-free lookup
+
+    auto
+    find(uint64_t channel_id) const -> channel_t* {
+        const array_t* array = m_array.load(std::memory_order_acquire);
+        const size_t   mask  = array->capacity - 1;
+
+        for(size_t i = channel_id & mask, probes = 0; probes < array->capacity; i = (i + 1) & mask, ++probes) {
+            const slot_t& slot = array->slots[i];
+            const uint64_t key = slot.key.load(std::memory_order_acquire);
+
+            if(key == 0) {
+                break;
+            } else if(key != channel_id) {
+                continue;
+            }
+
+            channel_t* channel = slot.value.load(std::memory_order_acquire);
+
+            // The tombstone might have been taken over by another channel in the meantime.
+            return slot.key.load(std::memory_order_acquire) == channel_id ? channel : nullptr;
+        }
+
+        return nullptr;
+    }
+
+    auto
+    retired() const -> bool {
+        return m_retired.load(std::memory_order_acquire);
+    }
+
+    // Synchronized operations
+
+    bool
+    empty() const {
+        return m_size == 0;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+
+    auto
+    insert(uint64_t channel_id, std::unique_ptr<channel_t> channel) -> channel_t* {
+        array_t* array = m_array.load(std::memory_order_relaxed);
+
+        if((m_used + 1) * 4 > array->capacity * 3) {
+            array = rehash();
+        }
+
+        slot_t& slot = *place(array, channel_id);
+
+        if(slot.key.load(std::memory_order_relaxed) == 0) {
+            m_used++;
+        }
+
+        // NOTE: The key must be published first, so that a concurrent lookup of the tombstone's
+        // original key would never see the new channel.
+        slot.key.store(channel_id, std::memory_order_release);
+        slot.value.store(channel.get(), std::memory_order_release);
+
+        m_size++;
+
+        return channel.release();
+    }
+
+    bool
+    erase(uint64_t channel_id) {
+        array_t* array = m_array.load(std::memory_order_relaxed);
+        const size_t mask = array->capacity - 1;
+
+        for(size_t i = channel_id & mask, probes = 0; probes < array->capacity; i = (i + 1) & mask, ++probes) {
+            slot_t& slot = array->slots[i];
+            const uint64_t key = slot.key.load(std::memory_order_relaxed);
+
+            if(key == 0) {
+                break;
+            } else if(key != channel_id) {
+                continue;
+            }
+
+            channel_t* channel = slot.value.exchange(nullptr, std::memory_order_release);
+
+            if(channel == nullptr) {
+                break;
+            }
+
+            retire(channel);
+            m_size--;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    template<class F>
+    void
+    for_each(F&& functor) const {
+        const array_t* array = m_array.load(std::memory_order_relaxed);
+
+        for(size_t i = 0; i < array->capacity; ++i) {
+            if(channel_t* channel = array->slots[i].value.load(std::memory_order_relaxed)) {
+                functor(array->slots[i].key.load(std::memory_order_relaxed), *channel);
+            }
+        }
+    }
+
+    void
+    clear() {
+        array_t* array = m_array.exchange(new array_t(kInitialCapacity), std::memory_order_acq_rel);
+
+        for(size_t i = 0; i < array->capacity; ++i) {
+            if(channel_t* channel = array->slots[i].value.load(std::memory_order_relaxed)) {
+                retire(channel);
+            }
+        }
+
+        retire(array);
+
+        m_size = 0;
+        m_used = 0;
+    }
+
+    // Hands over the retired channels and arrays to the caller, so that they could be destroyed out
+    // of the lock.
+    void
+    collect(garbage_t& garbage) {
+        std::swap(garbage, m_garbage);
+        m_retired.store(false, std::memory_order_release);
+    }
+
+private:
+    static
+    auto
+    place(array_t* array, uint64_t channel_id) -> slot_t* {
+        const size_t mask = array->capacity - 1;
+
+        for(size_t i = channel_id & mask;; i = (i + 1) & mask) {
+            slot_t& slot = array->slots[i];
+
+            if(slot.value.load(std::memory_order_relaxed) == nullptr) {
+                return &slot;
+            }
+        }
+    }
+
+    auto
+    rehash() -> array_t* {
+        array_t* array = m_array.load(std::memory_order_relaxed);
+        size_t capacity = array->capacity;
+
+        // Grow only if there are too many channels, otherwise just get rid of the tombstones.
+        while((m_size + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+
+        array_t* replacement = new array_t(capacity);
+
+        for(size_t i = 0; i < array->capacity; ++i) {
+            const slot_t& slot = array->slots[i];
+
+            if(channel_t* channel = slot.value.load(std::memory_order_relaxed)) {
+                slot_t& target = *place(replacement, slot.key.load(std::memory_order_relaxed));
+
+                target.key.store(slot.key.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                target.value.store(channel, std::memory_order_relaxed);
+            }
+        }
+
+        m_array.store(replacement, std::memory_order_release);
+        m_used = m_size;
+
+        retire(array);
+
+        return replacement;
+    }
+
+    void
+    retire(channel_t* channel) {
+        m_garbage.channels.emplace_back(channel);
+        m_retired.store(true, std::memory_order_release);
+    }
+
+    void
+    retire(array_t* array) {
+        m_garbage.arrays.emplace_back(array);
+        m_retired.store(true, std::memory_order_release);
+    }
+};
+
 // Session
 
+template<class Protocol>
 session_t::session_t(std::unique_ptr<logging::log_t> log_,
-                     std::unique_ptr<channel<tcp>> transport_, const dispatch_ptr_t& prototype_):
+                     std::unique_ptr<channel<Protocol>> transport_, const dispatch_ptr_t& prototype_,
+                     const std::shared_ptr<message_pool_t>& pool_,
+                     const std::shared_ptr<backpressure_t>& backpressure_):
     log(std::move(log_)),
-    transport(std::shared_ptr<channel<tcp>>(std::move(transport_))),
+    transport(std::make_shared<basic_transport_t<Protocol>>(std::move(transport_))),
     prototype(prototype_),
-    max_channel_id(0)
-{ }
+    channels(new synchronized<channel_table_t>()),
+    max_channel_id(0),
+    pool(pool_),
+    backlog(backpressure_->high, backpressure_->low),
+    backpressure(backpressure_),
+    overflown(false)
+{
+    pending.head  = nullptr;
+    pending.tail  = nullptr;
+    pending.bound = false;
+
+    owner.hook = nullptr;
+    owner.key  = -1;
+}
+
+template
+session_t::session_t(std::unique_ptr<logging::log_t>, std::unique_ptr<channel<tcp>>,
+                     const dispatch_ptr_t&, const std::shared_ptr<message_pool_t>&,
+                     const std::shared_ptr<backpressure_t>&);
+
+template
+session_t::session_t(std::unique_ptr<logging::log_t>, std::unique_ptr<channel<local::stream_protocol>>,
+                     const dispatch_ptr_t&, const std::shared_ptr<message_pool_t>&,
+                     const std::shared_ptr<backpressure_t>&);
+
+session_t::~session_t() {
+    // Close the connection first, so that the writer wouldn't touch the pending messages anymore.
+#if defined(__clang__)
+    transport = nullptr;
+#else
+    transport.unsafe() = nullptr;
+#endif
+
+    size_t dropped = 0;
+
+    while(pending.head) {
+        std::unique_ptr<pooled_message_t> message(pending.head);
+
+        pending.head = message->next;
+        dropped += message->message.size();
+        pool->recycle(std::move(message));
+    }
+
+    for(pooled_message_t* message = outbox.drain(); message;) {
+        pooled_message_t* next = message->next;
+        dropped += message->message.size();
+        pool->recycle(std::unique_ptr<pooled_message_t>(message));
+        message = next;
+    }
+
+    // Unwritten messages are no longer part of the shared backlog.
+    backpressure->release(dropped);
+}
 
 // Operations
 
 void
 session_t::handle(const decoder_t::message_type& message) {
-    const channel_map_t::key_type channel_id = message.span();
+    const uint64_t channel_id = message.span();
 
-    const auto channel = channels.apply([&](channel_map_t& mapping) -> std::shared_ptr<channel_t> {
-        channel_map_t::const_iterator lb, ub;
+    if(channels->unsafe().retired()) {
+        reclaim();
+    }
 
-        std::tie(lb, ub) = mapping.equal_range(channel_id);
+    // NOTE: The channel is not reclaimed until the next message, even if it's removed meanwhile.
+    channel_t* channel = channels->unsafe().find(channel_id);
 
-        if(lb == ub) {
+    if(channel == nullptr) {
+        channel = channels->apply([&](channel_table_t& table) -> channel_t* {
             if(channel_id <= max_channel_id) {
                 throw cocaine::error_t("specified channel id was revoked");
             }
 
-            std::tie(lb, std::ignore) = mapping.insert({channel_id, std::make_shared<channel_t>(
-                prototype,
-                std::make_shared<basic_upstream_t>(shared_from_this(), channel_id)
-            )});
-
             max_channel_id = channel_id;
-        }
 
-        // NOTE: The virtual channel pointer is copied here to avoid data races.
-        return lb->second;
-    });
+            return table.insert(channel_id, std::make_unique<channel_t>(
+                prototype,
+                std::make_shared<basic_upstream_t>(shared_from_this(), channel_id)
+            ));
+        });
+    }
 
     if(!channel->dispatch) {
         throw cocaine::error_t("no dispatch has been assigned");
@@ -202,15 +623,21 @@ session_t::handle(const decoder_t::message_type& message) {
         .get_value_or(channel->dispatch)) == nullptr)
     {
         // NOTE: If the client has sent us the last message according to our dispatch graph, revoke
-        // the channel. No-op if the channel is no longer in the mapping, e.g., was discarded during
+        // the channel. Skipped if the channel is no longer in the table, e.g., was discarded during
         // session::detach(), which was called during the dispatch::process().
-        if(!channel.unique()) revoke(channel_id);
+        if(channels->unsafe().find(channel_id) == channel) {
+            revoke(channel_id);
+        }
+
+        // No lookup is in progress here, so the channel can be freed right away, breaking the cycle
+        // between its upstream and the session instead of waiting for the next incoming frame.
+        reclaim();
     }
 }
 
 upstream_ptr_t
 session_t::fork(const dispatch_ptr_t& dispatch) {
-    return channels.apply([&](channel_map_t& mapping) -> upstream_ptr_t {
+    return channels->apply([&](channel_table_t& table) -> upstream_ptr_t {
         const auto channel_id = ++max_channel_id;
         const auto downstream = std::make_shared<basic_upstream_t>(shared_from_this(), channel_id);
 
@@ -220,7 +647,7 @@ session_t::fork(const dispatch_ptr_t& dispatch) {
         if(dispatch) {
             // NOTE: For mute slots, creating a new channel will essentially leak memory, since no
             // response will ever be sent back, therefore the channel will never be revoked at all.
-            mapping.insert({channel_id, std::make_shared<channel_t>(dispatch, downstream)});
+            table.insert(channel_id, std::make_unique<channel_t>(dispatch, downstream));
         }
 
         return downstream;
@@ -229,54 +656,163 @@ session_t::fork(const dispatch_ptr_t& dispatch) {
 
 void
 session_t::revoke(uint64_t channel_id) {
-    channels.apply([&](channel_map_t& mapping) {
-        auto it = mapping.find(channel_id);
+    channels->apply([&](channel_table_t& table) {
+        channel_t* channel = table.find(channel_id);
 
         // NOTE: Not sure if that can ever happen, but that's why people use asserts, right?
-        BOOST_ASSERT(it != mapping.end());
+        BOOST_ASSERT(channel != nullptr);
 
-        if(it->second->dispatch) {
+        if(channel == nullptr) {
+            COCAINE_LOG_ERROR(log, "unable to revoke channel %llu: no such channel", channel_id);
+            return;
+        }
+
+        if(channel->dispatch) {
             COCAINE_LOG_ERROR(log, "revoking channel %llu with dispatch: '%s'", channel_id,
-                it->second->dispatch->name());
-            it->second->dispatch->discard(std::error_code());
+                channel->dispatch->name());
+            channel->dispatch->discard(std::error_code());
         } else {
             COCAINE_LOG_DEBUG(log, "revoking channel %llu", channel_id);
         }
 
-        mapping.erase(it);
+        table.erase(channel_id);
     });
 }
 
+void
+session_t::reclaim() {
+    channel_table_t::garbage_t garbage;
+
+    channels->apply([&](channel_table_t& table) {
+        table.collect(garbage);
+    });
+
+    // The retired channels are destroyed here, out of the lock, as it might release the last
+    // references to some dispatches.
+}
+
 void
 session_t::detach(const std::error_code& ec) {
+    io_service* asio = nullptr;
+
 #if defined(__clang__)
-    if(auto channel = std::atomic_exchange(&transport, std::shared_ptr<io::channel<tcp>>())) {
+    if(auto channel = std::atomic_exchange(&transport, std::shared_ptr<transport_t>())) {
 #else
     if(auto channel = std::move(*transport.synchronize())) {
 #endif
+        asio = &channel->get_io_service();
         channel = nullptr;
         COCAINE_LOG_DEBUG(log, "detached session from the transport");
     } else {
         return;
     }
 
-    channels.apply([&](channel_map_t& mapping) {
-        if(mapping.empty()) {
+    channels->apply([&](channel_table_t& table) {
+        if(table.empty()) {
             return;
         } else {
-            COCAINE_LOG_DEBUG(log, "discarding %llu channel dispatch(es)", mapping.size());
+            COCAINE_LOG_DEBUG(log, "discarding %llu channel dispatch(es)", table.size());
         }
 
-        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
-            if(it->second->dispatch) it->second->dispatch->discard(ec);
-        }
+        table.for_each([&](uint64_t, channel_t& channel) {
+            if(channel.dispatch) channel.dispatch->discard(ec);
+        });
 
-        mapping.clear();
+        table.clear();
     });
+
+    const auto self = shared_from_this();
+
+    // Removed channels and the paused read operation hold references to the session, so release them
+    // as soon as no lookup could be in progress. Then let the owner drop its reference as well, so
+    // that the session is destroyed once all the upstreams are gone.
+    asio->post([self] {
+        self->paused = nullptr;
+        self->reclaim();
+
+        if(self->owner.hook) {
+            self->owner.hook->detached(*self, self->owner.key);
+            self->owner.hook = nullptr;
+        }
+    });
+}
+
+// Backpressure
+
+void
+session_t::pause(const std::shared_ptr<pull_action_t>& action) {
+    COCAINE_LOG_DEBUG(log, "pausing session, backlog: %llu bytes, shared backlog: %llu bytes",
+        backlog.size(), backpressure->size());
+
+    paused = action;
+
+    if(backpressure->congested()) {
+        backpressure->wait(shared_from_this());
+    }
+}
+
+void
+session_t::resume() {
+    if(!paused || backlog.congested()) {
+        return;
+    }
+
+    if(backpressure->congested()) {
+        return backpressure->wait(shared_from_this());
+    }
+
+    const auto action = std::move(paused);
+
+#if defined(__clang__)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        COCAINE_LOG_DEBUG(log, "resuming session");
+        (*action)(ptr);
+    }
+}
+
+session_t::backpressure_t::backpressure_t(const std::shared_ptr<io_service>& asio, size_t high_, size_t low_,
+                                          size_t shared_high, size_t shared_low):
+    m_asio(asio),
+    m_backlog(shared_high, shared_low),
+    high(high_),
+    low(low_)
+{ }
+
+void
+session_t::backpressure_t::release(size_t bytes) {
+    if(m_backlog.release(bytes)) {
+        // Might be called from any thread, e.g., when a session is destroyed.
+        m_asio->post(std::bind(&backpressure_t::notify, shared_from_this()));
+    }
+}
+
+void
+session_t::backpressure_t::wait(const std::shared_ptr<session_t>& session) {
+    m_waiters.push_back(session);
+}
+
+void
+session_t::backpressure_t::notify() {
+    std::vector<std::weak_ptr<session_t>> waiters;
+
+    std::swap(waiters, m_waiters);
+
+    for(auto it = waiters.begin(); it != waiters.end(); ++it) {
+        if(const auto session = it->lock()) session->resume();
+    }
 }
 
 // Channel I/O
 
+void
+session_t::bind(detach_hook_t* hook, int key) {
+    owner.hook = hook;
+    owner.key  = key;
+}
+
 void
 session_t::pull() {
 #if defined(__clang__)
@@ -285,7 +821,7 @@ session_t::pull() {
     if(const auto ptr = *transport.synchronize()) {
 #endif
         // Use dispatch() instead of a direct call for thread safety.
-        ptr->socket->get_io_service().dispatch(std::bind(&pull_action_t::operator(),
+        ptr->get_io_service().dispatch(std::bind(&pull_action_t::operator(),
             std::make_shared<pull_action_t>(shared_from_this()),
             ptr
         ));
@@ -296,36 +832,147 @@ session_t::pull() {
 
 void
 session_t::push(encoder_t::message_type&& message) {
+    auto pooled = pool->acquire();
+
+    pooled->message = std::move(message);
+
+    push(std::move(pooled));
+}
+
+void
+session_t::push(std::unique_ptr<pooled_message_t> message) {
+    const size_t size = message->message.size();
+
+    backlog.acquire(size);
+    backpressure->acquire(size);
+
+    // False if the outbox is already scheduled to be drained, and this message will be drained with
+    // it.
+    const bool schedule = outbox.push(std::move(message));
+
+    if(!schedule && !backlog.overflown()) {
+        return;
+    }
+
 #if defined(__clang__)
     if(const auto ptr = std::atomic_load(&transport)) {
 #else
     if(const auto ptr = *transport.synchronize()) {
 #endif
-        // Use dispatch() instead of a direct call for thread safety.
-        ptr->socket->get_io_service().dispatch(std::bind(&push_action_t::operator(),
-            std::make_shared<push_action_t>(std::move(message), shared_from_this()),
-            ptr
-        ));
-    } else {
+        if(schedule) {
+            // Use dispatch() instead of a direct call for thread safety.
+            ptr->get_io_service().dispatch(std::bind(&session_t::do_drain,
+                shared_from_this(),
+                ptr
+            ));
+        }
+
+        if(backlog.overflown() && !overflown.exchange(true)) {
+            COCAINE_LOG_ERROR(log, "closing session, backlog: %llu bytes", backlog.size());
+
+            // The peer doesn't keep up with the producers, so drop it instead of buffering without
+            // bounds. Posted, because detaching discards dispatches, which might call back into the
+            // producer sending this very message.
+            ptr->get_io_service().post(std::bind(&session_t::detach,
+                shared_from_this(),
+                std::error_code(error::congestion_error)
+            ));
+        }
+    } else if(schedule) {
+        // The message will be dropped along with the session.
+        outbox.cancel();
+
         throw cocaine::error_t("session is not connected");
     }
 }
 
+void
+session_t::do_drain(const std::shared_ptr<transport_t>& ptr) {
+    for(pooled_message_t* message = outbox.drain(); message;) {
+        pooled_message_t* next = message->next;
+        do_push(message, ptr);
+        message = next;
+    }
+}
+
+void
+session_t::do_push(pooled_message_t* message, const std::shared_ptr<transport_t>& ptr) {
+    message->next = nullptr;
+
+    if(pending.tail) {
+        pending.tail->next = message;
+    } else {
+        pending.head = message;
+    }
+
+    pending.tail = message;
+
+    if(!pending.bound) {
+        // All the outgoing messages are written without their own handlers, so that the session is
+        // notified about completions via the single stream-wide handler.
+        ptr->bind(write_handler_t(shared_from_this()));
+        pending.bound = true;
+    }
+
+    ptr->write(message->message);
+}
+
+void
+session_t::on_write(const std::error_code& ec) {
+    BOOST_ASSERT(pending.head != nullptr);
+
+    // Messages are completed in the same order they were written.
+    std::unique_ptr<pooled_message_t> message(pending.head);
+
+    if((pending.head = message->next) == nullptr) {
+        pending.tail = nullptr;
+    }
+
+    const size_t size = message->message.size();
+
+    pool->recycle(std::move(message));
+
+    backpressure->release(size);
+
+    if(backlog.release(size)) {
+        resume();
+    }
+
+    if(ec.value() == 0) return;
+
+    if(ec != asio::error::eof) {
+        COCAINE_LOG_ERROR(log, "client disconnected: [%d] %s", ec.value(), ec.message());
+    } else {
+        COCAINE_LOG_DEBUG(log, "client disconnected");
+    }
+
+    return detach(ec);
+}
+
 // Information
 
 std::map<uint64_t, std::string>
 session_t::active_channels() const {
-    return channels.apply([](const channel_map_t& mapping) -> std::map<uint64_t, std::string> {
+    return channels->apply([](const channel_table_t& table) -> std::map<uint64_t, std::string> {
         std::map<uint64_t, std::string> result;
 
-        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
-            result[it->first] = it->second->dispatch ? it->second->dispatch->name() : "<none>";
-        }
+        table.for_each([&](uint64_t channel_id, const channel_t& channel) {
+            result[channel_id] = channel.dispatch ? channel.dispatch->name() : "<none>";
+        });
 
         return result;
     });
 }
 
+bool
+session_t::connected() const {
+#if defined(__clang__)
+    return static_cast<bool>(std::atomic_load(&transport));
+#else
+    return static_cast<bool>(*transport.synchronize());
+#endif
+}
+
 size_t
 session_t::memory_pressure() const {
 #if defined(__clang__)
@@ -333,12 +980,17 @@ session_t::memory_pressure() const {
 #else
     if(const auto ptr = *transport.synchronize()) {
 #endif
-        return ptr->reader->pressure() + ptr->writer->pressure();
+        return ptr->pressure();
     } else {
         return 0;
     }
 }
 
+bool
+session_t::congested() const {
+    return backlog.congested() || backpressure->congested();
+}
+
 std::string
 session_t::name() const {
     return prototype ? prototype->name() : "<none>";
@@ -354,7 +1006,7 @@ session_t::remote_endpoint() const {
     if(const auto ptr = *transport.synchronize()) {
 #endif
         try {
-            endpoint = ptr->socket->remote_endpoint();
+            endpoint = ptr->remote_endpoint();
         } catch(const std::system_error& e) {
             // Ignore.
         }